@@ -34,6 +34,9 @@ enum TreeIndex { // Index of the output trees
   kFTOF,
   kA3ECAL,
   kA3Photon,
+  kHF3Prong,
+  kTrackAssoc,
+  kAmbiguousTrack,
   kTrees
 };
 
@@ -72,7 +75,10 @@ const TString TreeName[kTrees] = {"O2collision",
                                   "O2mid",
                                   "O2ftof",
                                   "O2a3ecal",
-                                  "O2photonconv"};
+                                  "O2photonconv",
+                                  "O2hftrackidxp3",
+                                  "O2trackassoc",
+                                  "O2ambiguoustrack"};
 
 const TString TreeTitle[kTrees] = {"Collision tree",
                                    "Collision extra",
@@ -106,7 +112,10 @@ const TString TreeTitle[kTrees] = {"Collision tree",
                                    "MID info",
                                    "Forward TOF info",
                                    "ALICE3 ECAL",
-                                   "PhotonConversion"};
+                                   "PhotonConversion",
+                                   "HF 3-prong candidates",
+                                   "Track to collision associations",
+                                   "Ambiguous tracks"};
 
 TTree* Trees[kTrees] = {nullptr}; // Array of created TTrees
 TTree* CreateTree(TreeIndex t)
@@ -166,6 +175,23 @@ void MakeTreeO2collision()
   tEvents->SetBasketSize("*", fBasketSizeEvents);
 }
 
+void setNominalVertex(decltype(collision)& vertex, UShort_t nContributors)
+{
+  // nominal vertex at the origin, when no vertex is reconstructed
+  vertex.fPosX = 0.f;
+  vertex.fPosY = 0.f;
+  vertex.fPosZ = 0.f;
+  vertex.fCovXX = 0.f;
+  vertex.fCovXY = 0.f;
+  vertex.fCovXZ = 0.f;
+  vertex.fCovYY = 0.f;
+  vertex.fCovYZ = 0.f;
+  vertex.fCovZZ = 0.f;
+  vertex.fFlags = 0;
+  vertex.fChi2 = 0.01f;
+  vertex.fN = nContributors;
+}
+
 struct {
   // Start indices and numbers of elements for data in the other trees matching this vertex.
   // Needed for random access of collision-related data, allowing skipping data discarded by the user
@@ -482,6 +508,86 @@ void MakeTreeO2ftof()
   tFTOF->SetBasketSize("*", fBasketSizeTracks);
 }
 
+struct {
+  // V0 data
+  Int_t fIndexCollisions = -1;  /// Collision ID
+  Int_t fIndexTracks_Pos = -1;  /// Positive daughter track ID
+  Int_t fIndexTracks_Neg = -1;  /// Negative daughter track ID
+} v0;                           //! structure to keep V0 info
+
+void MakeTreeO2v0()
+{
+  TTree* tV0s = CreateTree(kV0s);
+  tV0s->Branch("fIndexCollisions", &v0.fIndexCollisions, "fIndexCollisions/I");
+  tV0s->Branch("fIndexTracks_Pos", &v0.fIndexTracks_Pos, "fIndexTracks_Pos/I");
+  tV0s->Branch("fIndexTracks_Neg", &v0.fIndexTracks_Neg, "fIndexTracks_Neg/I");
+  tV0s->SetBasketSize("*", fBasketSizeTracks);
+}
+
+struct {
+  // Cascade data
+  Int_t fIndexCollisions = -1; /// Collision ID
+  Int_t fIndexV0s = -1;        /// V0 ID
+  Int_t fIndexTracks = -1;     /// Bachelor track ID
+} cascade;                     //! structure to keep cascade info
+
+void MakeTreeO2cascade()
+{
+  TTree* tCascades = CreateTree(kCascades);
+  tCascades->Branch("fIndexCollisions", &cascade.fIndexCollisions, "fIndexCollisions/I");
+  tCascades->Branch("fIndexV0s", &cascade.fIndexV0s, "fIndexV0s/I");
+  tCascades->Branch("fIndexTracks", &cascade.fIndexTracks, "fIndexTracks/I");
+  tCascades->SetBasketSize("*", fBasketSizeTracks);
+}
+
+struct {
+  // HF 3-prong candidate indices, skimmed by the ThreeProngFinder
+  Int_t fIndexCollisions = -1; /// Collision ID
+  Int_t fIndexTracks_0 = -1;   /// Prong track IDs
+  Int_t fIndexTracks_1 = -1;
+  Int_t fIndexTracks_2 = -1;
+  UChar_t fHFflag = 0u;        /// Decay hypotheses within the mass window, one bit each
+} hf3prong;                    //! structure to keep the HF 3-prong candidates
+
+void MakeTreeO2hf3prong()
+{
+  TTree* tHF3Prong = CreateTree(kHF3Prong);
+  tHF3Prong->Branch("fIndexCollisions", &hf3prong.fIndexCollisions, "fIndexCollisions/I");
+  tHF3Prong->Branch("fIndexTracks_0", &hf3prong.fIndexTracks_0, "fIndexTracks_0/I");
+  tHF3Prong->Branch("fIndexTracks_1", &hf3prong.fIndexTracks_1, "fIndexTracks_1/I");
+  tHF3Prong->Branch("fIndexTracks_2", &hf3prong.fIndexTracks_2, "fIndexTracks_2/I");
+  tHF3Prong->Branch("fHFflag", &hf3prong.fHFflag, "fHFflag/b");
+  tHF3Prong->SetBasketSize("*", fBasketSizeTracks);
+}
+
+struct {
+  // Time-window association, one entry per compatible collision of each track
+  Int_t fIndexCollisions = -1; /// Collision ID
+  Int_t fIndexTracks = -1;     /// Track ID
+} trackassoc;                  //! structure to keep the track to collision associations
+
+void MakeTreeO2trackassoc()
+{
+  TTree* tTrackAssoc = CreateTree(kTrackAssoc);
+  tTrackAssoc->Branch("fIndexCollisions", &trackassoc.fIndexCollisions, "fIndexCollisions/I");
+  tTrackAssoc->Branch("fIndexTracks", &trackassoc.fIndexTracks, "fIndexTracks/I");
+  tTrackAssoc->SetBasketSize("*", fBasketSizeTracks);
+}
+
+struct {
+  // Tracks compatible with more than one collision
+  Int_t fIndexTracks = -1;                /// Track ID
+  Int_t fIndexSlice_BCs[2] = {-1, -1};    /// First and last BC of the compatible collisions
+} ambiguoustrack;                         //! structure to keep the ambiguous tracks
+
+void MakeTreeO2ambiguoustrack()
+{
+  TTree* tAmbiguousTrack = CreateTree(kAmbiguousTrack);
+  tAmbiguousTrack->Branch("fIndexTracks", &ambiguoustrack.fIndexTracks, "fIndexTracks/I");
+  tAmbiguousTrack->Branch("fIndexSlice_BCs", ambiguoustrack.fIndexSlice_BCs, "fIndexSlice_BCs[2]/I");
+  tAmbiguousTrack->SetBasketSize("*", fBasketSizeTracks);
+}
+
 struct {
   // ALICE3 PhotonConversion
   Int_t fIndexCollisions = -1;  /// Collision ID
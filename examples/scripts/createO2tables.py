@@ -44,7 +44,14 @@ def main(configuration_file,
          use_nuclei,
          avoid_file_copy,
          debug_aod,
-         tof_mismatch):
+         tof_mismatch,
+         find_v0s,
+         find_hf3prong,
+         fast_vertexing,
+         time_frame_orbits,
+         interaction_rate,
+         associate_tracks,
+         vertexing_block):
     arguments = locals()  # List of arguments to put into the log
     parser = configparser.RawConfigParser()
     parser.read(configuration_file)
@@ -134,10 +141,15 @@ def main(configuration_file,
     if use_nuclei:
         lut_particles += ["de", "tr", "he3"]
     if create_luts:
-        # Creating LUTs
-        verbose_msg("Creating LUTs")
+        # Creating LUTs, identical requests are taken from the LUT cache if one is configured
+        lut_cache = opt("lut_cache", require=False)
+        lut_cache_arg = ""
+        if lut_cache:
+            lut_cache = os.path.expanduser(os.path.expandvars(lut_cache))
+            verbose_msg("Creating LUTs, cached in", lut_cache)
+            lut_cache_arg = f" -K {lut_cache}"
         lut_path = os.path.join(lut_path, "create_luts.sh")
-        run_cmd(f"{lut_path} -p {lut_path} -t {lut_tag} -B {float(bField)*0.1} -R {minimum_track_radius} -P \"0 1 2 3 4 5 6\" -j 1 -F 2>&1",
+        run_cmd(f"{lut_path} -p {lut_path} -t {lut_tag} -B {float(bField)*0.1} -R {minimum_track_radius} -P \"0 1 2 3 4 5 6\" -j 1 -F{lut_cache_arg} 2>&1",
                 f"Creating the lookup tables with tag {lut_tag} from {lut_path} script")
     else:
         # Fetching LUTs
@@ -252,7 +264,7 @@ def main(configuration_file,
     if turn_off_vertexing:
         set_config("createO2tables.C",
                    "constexpr bool do_vertexing = ", "false\;/")
-    else:  # Check that the geometry file for the vertexing is there
+    elif not fast_vertexing:  # Check that the geometry file for the vertexing is there
         if not os.path.isfile("o2sim_grp.root") or not os.path.isfile("o2sim_geometry.root"):
             run_cmd("mkdir tmpo2sim && cd tmpo2sim && o2-sim -m PIPE ITS MFT -g boxgen -n 1 -j 1 --configKeyValues 'BoxGun.number=1' && cp o2sim_grp.root .. && cp o2sim_geometry.root .. && cd .. && rm -r tmpo2sim")
     if use_nuclei:
@@ -261,6 +273,38 @@ def main(configuration_file,
     if debug_aod:
         set_config("createO2tables.C",
                    "constexpr bool debug_qa = ", "true\;/")
+    if find_v0s:
+        set_config("createO2tables.C",
+                   "constexpr bool do_v0finding = ", "true\;/")
+    if find_hf3prong:
+        set_config("createO2tables.C",
+                   "constexpr bool do_hf3prong = ", "true\;/")
+    if time_frame_orbits:
+        if time_frame_orbits < 0:
+            fatal_msg("time_frame_orbits", time_frame_orbits, "is negative")
+        # the data frames of a file are numbered from 1000 times its number, one per time frame
+        orbit_duration = 88.924e-6  # [s]
+        rate = interaction_rate if interaction_rate is not None else 10000.
+        time_frames = nevents / rate / (time_frame_orbits * orbit_duration)
+        if time_frames > 1000:
+            fatal_msg(nevents, "events at", rate, "Hz take about", int(time_frames), "time frames of",
+                      time_frame_orbits, "orbits, more than the 1000 of a file: use fewer events per run or longer time frames")
+        set_config("createO2tables.C",
+                   "constexpr int time_frame_orbits = ", f"{time_frame_orbits}\;/")
+    if vertexing_block != 1:
+        if vertexing_block < 0:
+            fatal_msg("vertexing_block", vertexing_block, "is negative")
+        if (find_v0s or find_hf3prong) and not turn_off_vertexing and not fast_vertexing:
+            fatal_msg("vertexing_block", vertexing_block,
+                      "is not 1: the V0 and HF 3-prong finding need the vertex of each collision, use --fast-vertexing or --vertexing-block 1")
+        set_config("createO2tables.C",
+                   "constexpr int vertexing_block = ", f"{vertexing_block}\;/")
+    if associate_tracks:
+        set_config("createO2tables.C",
+                   "constexpr bool do_association = ", "true\;/")
+    if interaction_rate is not None:
+        set_config("createO2tables.C",
+                   "const double interaction_rate = ", f"{interaction_rate}\;/")
     if tof_mismatch:
         if not tof_mismatch in [1, 2]:
             fatal_msg("tof_mismatch", tof_mismatch, "is not 1 or 2")
@@ -395,7 +439,7 @@ def main(configuration_file,
                                 check_status=True)
             aod_file = f"AODRun5.{run_number}.root"
             aod_log_file = aod_file.replace(".root", ".log")
-            write_to_runner(f"root -l -b -q 'createO2tables.C+(\"{delphes_file}\", \"tmp_{aod_file}\", 0)'",
+            write_to_runner(f"root -l -b -q 'createO2tables.C+(\"{delphes_file}\", \"tmp_{aod_file}\", 0, {str(fast_vertexing).lower()})'",
                             log_file=aod_log_file,
                             check_status=True)
             # Check that there were no O2 errors
@@ -526,6 +570,9 @@ if __name__ == "__main__":
     parser.add_argument("--no-vertexing",
                         action="store_true",
                         help="Option turning off the vertexing.")
+    parser.add_argument("--fast-vertexing",
+                        action="store_true",
+                        help="Option to use the analytic vertex fit instead of the O2 vertexing, no o2-sim geometry is needed.")
     parser.add_argument("--append", "-a",
                         action="store_true",
                         help="Option to append the results instead of starting over by shifting the AOD indexing. N.B. the user is responsible of the compatibility between appended AODs. Only works in conjuction by specifying an output path (option '-o')")
@@ -535,6 +582,27 @@ if __name__ == "__main__":
     parser.add_argument("--debug", "-d",
                         action="store_true",
                         help="Option to use the debug flag for the AOD making")
+    parser.add_argument("--v0s",
+                        action="store_true",
+                        help="Option to run the V0 and cascade finder and fill the O2v0 and O2cascade tables")
+    parser.add_argument("--hf3prong",
+                        action="store_true",
+                        help="Option to skim the HF 3-prong candidates and fill their index table")
+    parser.add_argument("--time-frame-orbits", "--tf",
+                        type=int,
+                        default=0,
+                        help="Time-frame mode: collisions are placed in BCs at the interaction rate and written in time frames of this many orbits, by default 0 (one BC per event)")
+    parser.add_argument("--interaction-rate",
+                        type=float,
+                        default=None,
+                        help="Interaction rate [Hz] of the sampled collision times, by default the one of createO2tables.C")
+    parser.add_argument("--vertexing-block",
+                        type=int,
+                        default=1,
+                        help="Number of collisions vertexed together in one call of the O2 vertexing, 0 for all the collisions of a data frame (time frame or file), by default 1")
+    parser.add_argument("--associate",
+                        action="store_true",
+                        help="Option to associate the tracks to the collisions compatible with their time and fill the O2trackassoc and O2ambiguoustrack tables")
     parser.add_argument("--tof-mismatch", "--tof_mismatch", "--use_tof_mismatch", "-t",
                         type=int,
                         default=0,
@@ -566,4 +634,11 @@ if __name__ == "__main__":
          use_nuclei=not args.no_nuclei,
          avoid_file_copy=args.avoid_config_copy,
          debug_aod=args.debug,
-         tof_mismatch=args.tof_mismatch)
+         tof_mismatch=args.tof_mismatch,
+         find_v0s=args.v0s,
+         find_hf3prong=args.hf3prong,
+         fast_vertexing=args.fast_vertexing,
+         time_frame_orbits=args.time_frame_orbits,
+         interaction_rate=args.interaction_rate,
+         associate_tracks=args.associate,
+         vertexing_block=args.vertexing_block)
@@ -11,14 +11,20 @@ fi
 OUT_PATH=.
 OUT_TAG=
 PARALLEL_JOBS=1
+THREADS=1
 PARTICLES="0 1 2 3 4"
 AUTOTAG="Yes"
 DIPOLE="No"
 FLATDIPOLE="No"
+EIGEN="Yes"
+RAD_BINS=1
+CORRECTION_BG=0
 VERBOSE="No"
+MACROS="No"
+LUT_CACHE=${DELPHESO2_LUT_CACHE}
 
 # List of arguments expected in the input
-optstring=":ht:B:R:p:o:T:P:j:vFDd"
+optstring=":ht:B:R:r:C:p:o:T:P:j:J:K:vFDdEM"
 # Get the options
 while getopts ${optstring} option; do
     case ${option} in
@@ -29,14 +35,20 @@ while getopts ${optstring} option; do
         echo "-t tag of the LUT writer [default]"
         echo "-B Magnetic field in T [0.5]"
         echo "-R Minimum radius of the track in cm [100]"
+        echo "-r Number of production radius bins, for secondaries [1]"
+        echo "-C Write species LUTs only up to this beta-gamma, as corrections to the universal LUT [0, full range]"
         echo "-p Path where the LUT writers are located [\$DELPHESO2_ROOT/lut/]"
         echo "-o Output path where to write the LUTs [.]"
         echo "-T Tag to append to LUTs [\"\"]"
-        echo "-P Particles to consider [\"0 1 2 3 4\"]"
+        echo "-P Particles to consider, 8 is the universal LUT [\"0 1 2 3 4\"]"
         echo "-j Number of parallel processes to use [1]"
+        echo "-J Number of threads per process, solving the LUT bins in parallel [1]"
+        echo "-K Directory where LUTs are cached by the hash of their full configuration [\$DELPHESO2_LUT_CACHE, no cache if empty]"
         echo "-F Don't use the automatic tagging and use only the one provided instead for the naming of the output files"
         echo "-D Use dipole"
         echo "-d Use dipole flat dipole parametrization"
+        echo "-E Skip the eigen decomposition, write only the Cholesky factor"
+        echo "-M Use the ROOT macros even if the compiled lut-writer is available"
         echo "-v Verbose mode"
         echo "-h Show this help"
         exit 0
@@ -53,6 +65,14 @@ while getopts ${optstring} option; do
         RMIN=$OPTARG
         echo " > Setting minimum radius to ${RMIN} cm"
         ;;
+    r)
+        RAD_BINS=$OPTARG
+        echo " > Setting production radius bins to ${RAD_BINS}"
+        ;;
+    C)
+        CORRECTION_BG=$OPTARG
+        echo " > Setting correction LUTs up to beta-gamma ${CORRECTION_BG}"
+        ;;
     p)
         WRITER_PATH=$OPTARG
         echo " > Setting LUT writer path to ${WRITER_PATH}"
@@ -73,6 +93,14 @@ while getopts ${optstring} option; do
         PARALLEL_JOBS=$OPTARG
         echo " > Setting parallel jobs to ${PARALLEL_JOBS}"
         ;;
+    J)
+        THREADS=$OPTARG
+        echo " > Setting threads per process to ${THREADS}"
+        ;;
+    K)
+        LUT_CACHE=$OPTARG
+        echo " > Setting LUT cache to ${LUT_CACHE}"
+        ;;
     F)
         AUTOTAG="No"
         echo " > Disabling autotagging mode"
@@ -85,6 +113,14 @@ while getopts ${optstring} option; do
         FLATDIPOLE="Yes"
         echo " > Enabling flat dipole"
         ;;
+    E)
+        EIGEN="No"
+        echo " > Disabling eigen decomposition"
+        ;;
+    M)
+        MACROS="Yes"
+        echo " > Using the ROOT macros"
+        ;;
     v)
         VERBOSE="Yes"
         echo " > Enabling verbose mode"
@@ -113,6 +149,25 @@ if [[ ${AUTOTAG} == "Yes" ]]; then
     OUT_TAG=".${FIELDT}kG.rmin${RMIN}.${WHAT}${OUT_TAG}"
 fi
 
+# compiled LUT writer, all particles are written by the same process
+LUT_WRITER=$(command -v lut-writer)
+if [[ ${MACROS} == "Yes" ]]; then
+    LUT_WRITER=""
+fi
+WRITER_ARGS="-t ${WHAT} -B ${FIELD} -R ${RMIN} -r ${RAD_BINS} -C ${CORRECTION_BG} -o ${OUT_PATH} -J ${THREADS} -F"
+if [[ ${DIPOLE} == "Yes" ]]; then
+    WRITER_ARGS="${WRITER_ARGS} -D"
+fi
+if [[ ${FLATDIPOLE} == "Yes" ]]; then
+    WRITER_ARGS="${WRITER_ARGS} -d"
+fi
+if [[ ${EIGEN} == "No" ]]; then
+    WRITER_ARGS="${WRITER_ARGS} -E"
+fi
+if [[ -n ${LUT_CACHE} ]]; then
+    WRITER_ARGS="${WRITER_ARGS} -K ${LUT_CACHE}"
+fi
+
 if [[ ${DIPOLE} == "Yes" ]]; then
     DIPOLE="useDipole = 1;"
 else
@@ -125,6 +180,12 @@ else
     FLATDIPOLE=""
 fi
 
+if [[ ${EIGEN} == "No" ]]; then
+    EIGEN="useEigen = 0;"
+else
+    EIGEN=""
+fi
+
 if [[ ${VERBOSE} == "Yes" ]]; then
     echo "WHAT='${WHAT}'"
     echo "FIELD='${FIELD}'"
@@ -133,10 +194,30 @@ if [[ ${VERBOSE} == "Yes" ]]; then
     echo "OUT_PATH='${OUT_PATH}'"
     echo "OUT_TAG='${OUT_TAG}'"
     echo "PARALLEL_JOBS='${PARALLEL_JOBS}'"
+    echo "THREADS='${THREADS}'"
     echo "PARTICLES='${PARTICLES}'"
     echo "AUTOTAG='${AUTOTAG}'"
 fi
 
+function do_lut_with_writer() {
+    ${LUT_WRITER} ${WRITER_ARGS} -T "${OUT_TAG}" -P ${1}
+}
+
+if [[ -n ${LUT_WRITER} ]]; then
+    echo " --- creating LUTs with ${LUT_WRITER}: config = ${WHAT}, field = ${FIELD} T, min tracking radius = ${RMIN} cm"
+    if [[ ${PARALLEL_JOBS} -le 1 ]]; then
+        do_lut_with_writer "${PARTICLES}"
+    else
+        N_RAN=0
+        for i in ${PARTICLES}; do
+            ((N_RAN = N_RAN % PARALLEL_JOBS))
+            ((N_RAN++ == 0)) && wait
+            do_lut_with_writer "${i}" &
+        done
+        wait
+    fi
+else
+
 if [[ -z ${WRITER_PATH} ]]; then
     echo "Path of the LUT writers not defined, cannot continue"
     exit 1
@@ -169,6 +250,11 @@ function do_lut_for_particle() {
     .L lutWrite.cc
     $DIPOLE
     $FLATDIPOLE
+    $EIGEN
+    nRadBins = ${RAD_BINS};
+    correctionBetaGamma = ${CORRECTION_BG};
+    nThreads = ${THREADS};
+    lutCacheDir = "${LUT_CACHE}";
     .L lutWrite.${WHAT}.cc
     printLutWriterConfiguration();
 
@@ -181,9 +267,9 @@ function do_lut_for_particle() {
     TDatabasePDG::Instance()->AddParticle("helium3", "helium3", 2.80839160743, kTRUE, 0.0, 6, "Nucleus", 1000020030);
     TDatabasePDG::Instance()->AddAntiParticle("anti-helium3", -1000020030);
 
-    const int N = 8;
-    const TString pn[N] = {"el", "mu", "pi", "ka", "pr", "de", "tr", "he3"};
-    const int pc[N] = {11, 13, 211, 321, 2212, 1000010020, 1000010030, 1000020030 };
+    const int N = 9;
+    const TString pn[N] = {"el", "mu", "pi", "ka", "pr", "de", "tr", "he3", "un"};
+    const int pc[N] = {11, 13, 211, 321, 2212, 1000010020, 1000010030, 1000020030, 0 };
     const float field = ${FIELD};
     const float rmin = ${RMIN};
     const int i = ${1};
@@ -214,9 +300,11 @@ done
 
 wait
 
+fi
+
 # Checking that the output LUTs are OK
 NullSize=""
-P=(el mu pi ka pr de tr he3)
+P=(el mu pi ka pr de tr he3 un)
 for i in $PARTICLES; do
     LUT_FILE=${OUT_PATH}/lutCovm.${P[$i]}${OUT_TAG}.dat
     if [[ ! -s ${LUT_FILE} ]]; then
@@ -8,8 +8,13 @@
 #pragma link off all functions;
 
 #pragma link C++ class o2::delphes::VertexFitter+;
+#pragma link C++ class o2::delphes::V0Finder+;
+#pragma link C++ class o2::delphes::ThreeProngFinder+;
+#pragma link C++ class o2::delphes::FastVertexer+;
+#pragma link C++ class o2::delphes::TrackAssociator+;
 #pragma link C++ class o2::delphes::TrackSmearer+;
 #pragma link C++ class o2::delphes::TrackUtils+;
+#pragma link C++ class o2::delphes::EtaPhiCells+;
 #pragma link C++ class o2::delphes::TOFLayer+;
 #pragma link C++ class o2::delphes::RICHdetector+;
 #pragma link C++ class o2::delphes::MIDdetector+;
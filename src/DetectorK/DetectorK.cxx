@@ -11,6 +11,8 @@
 #include <TGraphErrors.h>
 
 #include "AliExternalTrackParam.h"
+#include <vector>
+#include <algorithm>
 
 /***********************************************************
 
@@ -95,7 +97,8 @@ DetectorK::DetectorK()
   fptScale(10.),
   fdNdEtaCent(2200),
   kDetLayer(-1),
-  fMinRadTrack(132.)
+  fMinRadTrack(132.),
+  fProductionRadius(0.)
 {
   //
   // default constructor
@@ -124,7 +127,8 @@ DetectorK::DetectorK(char *name, char *title)
     fptScale(10.),
     fdNdEtaCent(2200),
     kDetLayer(-1),
-    fMinRadTrack(132.)
+    fMinRadTrack(132.),
+    fProductionRadius(0.)
 {
   //
   // default constructor, that set the name and title
@@ -145,6 +149,11 @@ void DetectorK::AddLayer(char *name, Float_t radius, Float_t radL, Float_t xrho,
 
   CylLayerK *newLayer = (CylLayerK*) fLayers.FindObject(name);
 
+  if (!newLayer && fLayers.GetEntries() >= TrackSol::kMaxLayers) {
+    printf("Error: cannot add layer %s, the good hit probabilities of TrackSol hold at most %d layers\n", name, TrackSol::kMaxLayers);
+    return;
+  }
+
   if (!newLayer) {
     newLayer = new CylLayerK(name);
     newLayer->radius = radius;
@@ -184,6 +193,8 @@ void DetectorK::AddLayer(char *name, Float_t radius, Float_t radL, Float_t xrho,
     }
 
 
+    UpdateSolver();
+
   } else {
     printf("Layer with the name %s does already exist\n",name);
   }
@@ -227,10 +238,11 @@ void DetectorK::SetRadius(char *name, Float_t radius) {
     Float_t tmpXRho  = tmp->xrho;
     Float_t tmpPhiRes = tmp->phiRes;
     Float_t tmpZRes = tmp->zRes;
+    Float_t tmpEff = tmp->eff;
     
 
     RemoveLayer(name); // so that the ordering is correct
-    AddLayer(name,radius,tmpRadL,tmpXRho,tmpPhiRes,tmpZRes);
+    AddLayer(name,radius,tmpRadL,tmpXRho,tmpPhiRes,tmpZRes,tmpEff);
   }
 }
 
@@ -374,6 +386,7 @@ void DetectorK::RemoveLayer(char *name) {
       if ( IsITSLayer(lname) ) fNumberOfActiveITSLayers -= 1;
       
     }
+    UpdateSolver();
   }
 }
 
@@ -476,6 +489,22 @@ void DetectorK::PrintLayout(Bool_t full) {
   }
 }
 
+TString DetectorK::GetLayoutKey() const {
+  //
+  // Full description of the layout and of the tracking settings,
+  // e.g. to identify the look-up tables computed with them
+  //
+  TString key = Form("B=%.9g;upc=%.9g;tint=%.9g;cl=%.9g;mass=%.9g;rap=%.9g;snp=%.9g;rslow=%.9g;hits=%d/%d/%d;seed=%.9g;rmin=%.9g\n",
+		     fBField, fLhcUPCscale, fIntegrationTime, fConfLevel, fParticleMass, fAvgRapidity, fMaxSnp, fMaxRadiusSlowDet,
+		     fAtLeastHits, fAtLeastCorr, fAtLeastFake, fMaxSeedRadius, fMinRadTrack);
+  for (Int_t i = 0; i<fLayers.GetEntries(); i++) {
+    CylLayerK *tmp = (CylLayerK*)fLayers.At(i);
+    key += Form("%s;%.9g;%.9g;%.9g;%.9g;%.9g;%.9g;%d\n", tmp->GetName(), tmp->radius, tmp->radL, tmp->xrho,
+		tmp->phiRes, tmp->zRes, tmp->eff, tmp->isDead);
+  }
+  return key;
+}
+
 void DetectorK::PlotLayout(Int_t plotDead) {
   //
   // Plots the detector layout in Front view
@@ -613,7 +642,7 @@ Double_t DetectorK::ThetaMCS ( Double_t mass, Double_t radLength, Double_t momen
 }
 
 
-Double_t DetectorK::ProbGoodHit ( Double_t radius, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) 
+Double_t DetectorK::ProbGoodHit ( Double_t radius, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) const
 {
   // Based on work by Howard Wieman: http://rnc.lbl.gov/~wieman/GhostTracks.htm 
   // and http://rnc.lbl.gov/~wieman/HitFinding2D.htm
@@ -626,7 +655,7 @@ Double_t DetectorK::ProbGoodHit ( Double_t radius, Double_t searchRadiusRPhi, Do
 }
 
 
-Double_t DetectorK::ProbGoodChiSqHit ( Double_t radius, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) 
+Double_t DetectorK::ProbGoodChiSqHit ( Double_t radius, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) const
 {
   // Based on work by Victor Perevoztchikov and Howard Wieman: http://rnc.lbl.gov/~wieman/HitFinding2DXsq.htm
   // This is the probability of getting a good hit using a Chi**2 search on a 2D Gaussian distribution function
@@ -636,7 +665,7 @@ Double_t DetectorK::ProbGoodChiSqHit ( Double_t radius, Double_t searchRadiusRPh
   return ( goodHit ) ;  
 }
 
-Double_t DetectorK::ProbGoodChiSqPlusConfHit ( Double_t radius, Double_t leff, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) 
+Double_t DetectorK::ProbGoodChiSqPlusConfHit ( Double_t radius, Double_t leff, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) const
 {
   // Based on work by Ruben Shahoyen 
   // This is the probability of getting a good hit using a Chi**2 search on a 2D Gaussian distribution function
@@ -649,7 +678,7 @@ Double_t DetectorK::ProbGoodChiSqPlusConfHit ( Double_t radius, Double_t leff, D
   return ( goodHit ) ;  
 }
 
-Double_t DetectorK::ProbNullChiSqPlusConfHit ( Double_t radius, Double_t leff, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) 
+Double_t DetectorK::ProbNullChiSqPlusConfHit ( Double_t radius, Double_t leff, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) const
 {
   // Based on work by Ruben Shahoyen 
   // This is the probability to not have any match to the track (see also :ProbGoodChiSqPlusConfHit:)
@@ -660,7 +689,49 @@ Double_t DetectorK::ProbNullChiSqPlusConfHit ( Double_t radius, Double_t leff, D
   return ( nullHit ) ;  
 }
 
-Double_t DetectorK::HitDensity ( Double_t radius ) 
+Double_t DetectorK::HitDensity ( Double_t radius ) const
+{
+  // Tabulated at the layer radii for the current multiplicity, computed otherwise
+  auto it = fHitDensity.find(radius);
+  if (it != fHitDensity.end()) return it->second;
+  return ComputeHitDensity(radius);
+}
+
+std::vector<SolverLayerK> DetectorK::BuildSolverLayers() const
+{
+  // Flat copy of the layer list for SolveTrack, with the layer types resolved from the names
+  std::vector<SolverLayerK> layers(fLayers.GetEntries());
+  for (Int_t i=0; i<fLayers.GetEntries(); i++) {
+    CylLayerK *l = (CylLayerK*)fLayers.At(i);
+    TString name(l->GetName());
+    layers[i].layer = l;
+    layers[i].isVertex = name.Contains("vertex");
+    layers[i].isTOF = name.Contains("tof");
+  }
+  return layers;
+}
+
+void DetectorK::UpdateSolver()
+{
+  // To be called whenever layers are added or removed
+  fSolverLayers = BuildSolverLayers();
+  UpdateHitDensity();
+}
+
+void DetectorK::UpdateHitDensity()
+{
+  // Tabulates the hit density at the layer radii, in cm and in the x100 units used for the good-hit probability.
+  // To be called whenever the geometry, the multiplicity or the background configuration change
+  fHitDensity.clear();
+  for (Int_t i=0; i<fLayers.GetEntries(); i++) {
+    CylLayerK *l = (CylLayerK*)fLayers.At(i);
+    if (l->radius <= 0) continue;
+    fHitDensity[l->radius] = ComputeHitDensity(l->radius);
+    fHitDensity[l->radius * 100.] = ComputeHitDensity(l->radius * 100.);
+  }
+}
+
+Double_t DetectorK::ComputeHitDensity ( Double_t radius ) const
 {
   // Background (0-1) is included via 'OtherBackground' which multiplies the minBias rate by a scale factor.
   // UPC electrons is a temporary kludge that is based on Kai Schweda's summary of Kai Hainken's MC results
@@ -709,7 +780,7 @@ double DetectorK::OneEventHitDensity( Double_t multiplicity, Double_t radius ) c
 } 
 
 
-double DetectorK::IntegratedHitDensity(Double_t multiplicity, Double_t radius)
+double DetectorK::IntegratedHitDensity(Double_t multiplicity, Double_t radius) const
 { 
   // The integral of minBias events smeared over a gaussian vertex distribution.
   // Based on work by Yan Lu 12/20/2006, all radii in centimeters.
@@ -724,7 +795,7 @@ double DetectorK::IntegratedHitDensity(Double_t multiplicity, Double_t radius)
 } 
 
 
-double DetectorK::UpcHitDensity(Double_t radius)
+double DetectorK::UpcHitDensity(Double_t radius) const
 { 
   // QED electrons ...
 
@@ -740,7 +811,7 @@ double DetectorK::UpcHitDensity(Double_t radius)
 } 
 
 
-double DetectorK::Dist(double z, double r)
+double DetectorK::Dist(double z, double r) const
 {
   // Convolute dEta/dZ  distribution with assumed Gaussian of vertex z distribution
   // Based on work by Howard Wieman http://rnc.lbl.gov/~wieman/HitDensityMeasuredLuminosity7.htm
@@ -801,28 +872,12 @@ void DetectorK::SolveViaBilloir(Double_t selPt, double ptmin) {
   if ( TMath::Abs(charge)>1.2) fParticleMass = -TMath::Abs(fParticleMass);
 
   // Prepare Probability Kombinations
-  Int_t nLayer = fNumberOfActiveITSLayers;
   Int_t base = 3; // null, fake, correct
 
 
   printf("N ITS Layers: %d\n",fNumberOfActiveITSLayers);
 
   TMatrixD probLay(base,fNumberOfActiveITSLayers);
-  TObjArray probKombArr;
-  probKombArr.Expand(nLayer);
-  probKombArr.SetOwner(kTRUE);
-  for (int nl=3;nl<=nLayer;nl++) {
-    Int_t komb = (Int_t) TMath::Power(base,nl);
-    TMatrixD *probKombP = new TMatrixD(komb,nl);
-    TMatrixD &probKomb = *probKombP;
-    for (Int_t num=0; num<komb; num++) {
-      for (Int_t l=nl; l--;) {
-	Int_t pow = ((Int_t)TMath::Power(base,l+1));
-	probKomb(num,nl-1-l)=(num%pow)/((Int_t)TMath::Power(base,l));
-      }
-    }
-    probKombArr[nl-3] = probKombP;
-  }
 
   CylLayerK *last = (CylLayerK*) fLayers.At((fLayers.GetEntries()-1));
   if (last->radius > fMinRadTrack) {
@@ -1132,9 +1187,8 @@ void DetectorK::SolveViaBilloir(Double_t selPt, double ptmin) {
       */
     }
     if (fAtLeastCorr != -1 || fAtLeastHits) {
-      // Calculate probabilities from Kombinatorics tree ...
-      TMatrixD *probKombPP = (TMatrixD*)probKombArr[iLayActive-3];
-      Double_t *probs = PrepareEffFakeKombinations(probKombPP, &probLay,iLayActive);
+      // Calculate probabilities from Kombinatorics ...
+      Double_t *probs = PrepareEffFakeKombinations(&probLay,iLayActive);
       fEfficiency[i] = probs[0]; // efficiency
       fFake[i] = probs[1];       // fake
       delete[] probs;
@@ -1394,9 +1448,8 @@ void DetectorK::SolveViaBilloir(Double_t selPt, double ptmin) {
 	}
       }
       if (fAtLeastCorr != -1 || fAtLeastHits != -1 ) {
-	// Calculate probabilities from Kombinatorics tree ...
-	TMatrixD *probKombPP = (TMatrixD*)probKombArr[iLayActive-3];
-	Double_t *probs = PrepareEffFakeKombinations(probKombPP, &probLay, iLayActive);
+	// Calculate probabilities from Kombinatorics ...
+	Double_t *probs = PrepareEffFakeKombinations(&probLay, iLayActive);
 	fEfficiency[i] = probs[0]; // efficiency
 	fFake[i] = probs[1];       // fake
 	delete[] probs;
@@ -1418,192 +1471,252 @@ void DetectorK::SolveViaBilloir(Double_t selPt, double ptmin) {
  
 }
 
-Bool_t DetectorK::SolveTrack(TrackSol& ts) {
+Bool_t DetectorK::SolveTrack(TrackSol& ts) const {
   //
   // Solves the current geometry for single track of given kinematics
+  // All the solver state lives in ts, the geometry is only read: can be called concurrently
   //
-  double ptTr = ts.fPt;
-  double etaTr = ts.fEta;
-  double mass = ts.fMass;
-  double charge = ts.fCharge;
+  TrackSol *pack = &ts;
+  Bool_t solved = kFALSE;
+  SolveTracks(&pack, 1, &solved);
+  return solved;
+}
 
-  // reset good hit probability
-  for (int i = 0; i < kMaxNumberOfDetectors; ++i)
-    fGoodHitProb[i] = -1.;
-  fGoodHitProb[0] = 1.; // we use layer zero to accumulate
-    
-  if (ptTr<0) { 
-    printf("Input track is not initialized");
-    return kFALSE;
+Int_t DetectorK::SolveTracks(TrackSol **ts, Int_t n, Bool_t *solved) const {
+  //
+  // Solves a pack of tracks, e.g. the pt bins of a LUT at fixed eta, in one call: the layer loops
+  // run over the pack, each track is still an AliExternalTrackParam propagated on its own, so this
+  // is a batching interface and not a vectorised solver. Tracks that cannot be tracked to
+  // fMinRadTrack are masked out of the pack, the others give the same results as SolveTrack.
+  // Returns the number of solved tracks, flagged in solved[]
+  //
+  for (int it = 0; it < n; ++it)
+    solved[it] = kFALSE;
+  if (fLayers.GetEntries() > TrackSol::kMaxLayers) {
+    printf("Error: %d layers, the good hit probabilities of TrackSol hold at most %d\n", fLayers.GetEntries(), TrackSol::kMaxLayers);
+    return 0;
+  }
+  for (int it = 0; it < n; ++it) {
+    // reset good hit probability
+    Double_t *goodHitProb = ts[it]->fGoodHitProb;
+    for (int i = 0; i < TrackSol::kMaxLayers; ++i)
+      goodHitProb[i] = -1.;
+    goodHitProb[0] = 1.; // we use layer zero to accumulate
   }
   
   const float kTrackingMargin = 0.1;
 
-  static AliExternalTrackParam probTr;   // track to propagate
-  probTr.SetUseLogTermMS(kTRUE);
-  //
-  TClonesArray &saveParInward    = ts.fTrackInw;
-  TClonesArray &saveParOutwardB  = ts.fTrackOutB;
-  TClonesArray &saveParOutwardA  = ts.fTrackOutA;
-  TClonesArray &saveParComb      = ts.fTrackCmb;
-
-  Double_t pt,lambda;
+  // the MS log term is a global switch of AliExternalTrackParam: on for the solve and reset after it,
+  // as in SolveViaBilloir. Concurrent callers turn it on beforehand, then it is not written here
+  struct LogTermMS {
+    const Bool_t previous = AliExternalTrackParam::GetUseLogTermMS();
+    LogTermMS() { if (!previous) AliExternalTrackParam::SetUseLogTermMS(kTRUE); }
+    ~LogTermMS() { if (!previous) AliExternalTrackParam::SetUseLogTermMS(kFALSE); }
+  } logTermMS;
+  //
+  // flat layer array with the layer types resolved, rebuilt locally if out of sync (e.g. after streaming)
+  std::vector<SolverLayerK> rebuiltLayers;
+  const SolverLayerK *layers = fSolverLayers.data();
+  const Int_t nLayers = fLayers.GetEntries();
+  if ((Int_t)fSolverLayers.size() != nLayers) {
+    rebuiltLayers = BuildSolverLayers();
+    layers = rebuiltLayers.data();
+  }
   //
-  CylLayerK *last = (CylLayerK*) fLayers.At((fLayers.GetEntries()-1));
+  CylLayerK *last = layers[nLayers-1].layer;
   double maxR = last->radius+kTrackingMargin*2;
   double minRad = (fMinRadTrack>0&&fMinRadTrack<maxR) ? fMinRadTrack : maxR;
   //
   if (last->radius > minRad) {
     last = 0;
-    for (Int_t i=0; i<fLayers.GetEntries();i++) {
-      CylLayerK *l = (CylLayerK*) fLayers.At(i);
+    for (Int_t i=0; i<nLayers;i++) {
+      CylLayerK *l = layers[i].layer;
       if (/*!(l->isDead) && */(l->radius<minRad)) last = l;
     }
     if (!last) {
       printf("No layer with radius < %f is found\n",minRad);
-      return kFALSE;
+      return 0;
     }
   }
-  //  
-  lambda = TMath::Pi()/2.0 - 2.0*TMath::ATan(TMath::Exp(-etaTr));
-  //  
+  //
   // Assume track started at (0,0,0) and shoots out on the X axis, and B field is on the Z axis
   // These are the EndPoint values for y, z, a, b, and d
   double bGauss = fBField*10;               // field in kgauss
-  pt  =  ptTr;
   enum {kY,kZ,kSnp,kTgl,kPtI};              // track parameter aliases
   enum {kY2,kYZ,kZ2,kYSnp,kZSnp,kSnp2,kYTgl,kZTgl,kSnpTgl,kTgl2,kYPtI,kZPtI,kSnpPtI,kTglPtI,kPtI2}; // cov.matrix aliases
   //
-  probTr.Reset();
-  double *trPars = (double*)probTr.GetParameter();
-  double *trCov  = (double*)probTr.GetCovariance();
-  trPars[kY] = 0;                         // start from Y = 0
-  trPars[kZ] = 0;                         //            Z = 0 
-  trPars[kSnp] = 0;                       //            track along X axis at the vertex
-  trPars[kTgl] = TMath::Tan(lambda);      //            dip
-  trPars[kPtI] = charge/pt;               //            q/pt      
-  //
-  // put tiny errors to propagate to the outer radius
-  trCov[kY2] = trCov[kZ2] = trCov[kSnp2] = trCov[kTgl2] = trCov[kPtI2] = 1e-9;
-  //
-  // find max layer this track can reach
-  double rmx = (TMath::Abs(fBField)>1e-5) ?  pt*100./(0.3*TMath::Abs(fBField)) : 9999;
-  //  if (2*rmx-5. < minRad && minRad>0) {
-  if ( minRad/(2.*rmx)>fMaxSnp-0.01 && minRad>0) {
-    //    printf("Track of pt=%.3f cannot be tracked to min. r=%f\n",pt,minRad);
-    return kFALSE;
-  }
-  Int_t lastActiveLayer = -1, lastReachedLayer = -1;
-  for (Int_t j=fLayers.GetEntries(); j--;) { 
-    CylLayerK *l = (CylLayerK*) fLayers.At(j);
-    if (/*!(l->isDead) && */(l->radius <= 2*(rmx-5))) {lastActiveLayer = j; last = l; break;}
-  }
-  if (lastActiveLayer<0) {
-    printf("No active layer with radius < %f is found, pt = %f\n",rmx, pt);
-    return kFALSE;
-  }
-  //
-  for (int il=1;il<=lastActiveLayer;il++) {
-    CylLayerK *lr = (CylLayerK*) fLayers.At(il);
-    AliExternalTrackParam probTrLast(probTr);
-    bool ok = PropagateToR(&probTrLast,lr->radius,bGauss,1);
-    if (ok) ok = probTrLast.CorrectForMeanMaterial(lr->radL, 0, mass , kTRUE);
-    if (ok && lr->xrho>0) {
-      for (int ise=xrhosteps;ise--;) {
-	ok = probTrLast.CorrectForMeanMaterial(0, -lr->xrho/xrhosteps, mass , kTRUE);
-	if (!ok) break;
-      }
+  // per-track state of the pack, tracks leave the mask when they cannot be solved
+  std::vector<AliExternalTrackParam> probTr(n);   // tracks to propagate
+  std::vector<Double_t> pt(n), rmx(n);
+  std::vector<Int_t> lastActiveLayer(n, -1), lastReachedLayer(n, -1);
+  std::vector<Bool_t> active(n, kFALSE), outward(n, kFALSE);
+  Int_t maxActiveLayer = -1;
+  //
+  for (int it = 0; it < n; ++it) {
+    pt[it] = ts[it]->fPt;
+    // find max layer this track can reach
+    rmx[it] = (TMath::Abs(fBField)>1e-5) ?  pt[it]*100./(0.3*TMath::Abs(fBField)) : 9999;
+  }
+  for (int it = 0; it < n; ++it) {
+    if (pt[it]<0) { 
+      printf("Input track is not initialized");
+      continue;
     }
-    if (ok && lr->radius>1e-3 && !lr->isDead) {
-      ok = probTrLast.Rotate(probTrLast.PhiPos()) && TMath::Abs( probTrLast.GetSnp() )<fMaxSnp;
+    //  if (2*rmx-5. < minRad && minRad>0) {
+    if ( minRad/(2.*rmx[it])>fMaxSnp-0.01 && minRad>0) {
+      //    printf("Track of pt=%.3f cannot be tracked to min. r=%f\n",pt,minRad);
+      continue;
+    }
+    for (Int_t j=nLayers; j--;) { 
+      CylLayerK *l = layers[j].layer;
+      if (/*!(l->isDead) && */(l->radius <= 2*(rmx[it]-5))) {lastActiveLayer[it] = j; break;}
+    }
+    if (lastActiveLayer[it]<0) {
+      printf("No active layer with radius < %f is found, pt = %f\n",rmx[it], pt[it]);
+      continue;
     }
-    // was there a problem on this layer?
-    if (!ok) { // may fail to reach target layer due to the eloss
-      double rad2 = probTr.GetX()*probTr.GetX() + probTr.GetY()*probTr.GetY();
-      if (rad2 - minRad*minRad < kTrackingMargin*kTrackingMargin) { // check previously reached layer
-	return kFALSE; // did not reach min requested layer
+    maxActiveLayer = TMath::Max(maxActiveLayer, lastActiveLayer[it]);
+    active[it] = outward[it] = kTRUE;
+    //
+    double lambda = TMath::Pi()/2.0 - 2.0*TMath::ATan(TMath::Exp(-ts[it]->fEta));
+    probTr[it].Reset();
+    double *trPars = (double*)probTr[it].GetParameter();
+    double *trCov  = (double*)probTr[it].GetCovariance();
+    trPars[kY] = 0;                         // start from Y = 0
+    trPars[kZ] = 0;                         //            Z = 0 
+    trPars[kSnp] = 0;                       //            track along X axis at the vertex
+    trPars[kTgl] = TMath::Tan(lambda);      //            dip
+    trPars[kPtI] = ts[it]->fCharge/pt[it];  //            q/pt      
+    //
+    // put tiny errors to propagate to the outer radius
+    trCov[kY2] = trCov[kZ2] = trCov[kSnp2] = trCov[kTgl2] = trCov[kPtI2] = 1e-9;
+  }
+  //
+  for (int il=1;il<=maxActiveLayer;il++) {
+    CylLayerK *lr = layers[il].layer;
+    Bool_t isInside = lr->radius < fProductionRadius; // not crossed by a secondary track
+    for (int it = 0; it < n; ++it) {
+      if (!outward[it] || il > lastActiveLayer[it]) continue;
+      double mass = ts[it]->fMass;
+      AliExternalTrackParam probTrLast(probTr[it]);
+      bool ok = PropagateToR(&probTrLast,lr->radius,bGauss,1);
+      if (ok && !isInside) ok = probTrLast.CorrectForMeanMaterial(lr->radL, 0, mass , kTRUE);
+      if (ok && !isInside && lr->xrho>0) {
+	for (int ise=xrhosteps;ise--;) {
+	  ok = probTrLast.CorrectForMeanMaterial(0, -lr->xrho/xrhosteps, mass , kTRUE);
+	  if (!ok) break;
+	}
       }
-      else {
-	break;
+      if (ok && lr->radius>1e-3 && !lr->isDead) {
+	ok = probTrLast.Rotate(probTrLast.PhiPos()) && TMath::Abs( probTrLast.GetSnp() )<fMaxSnp;
       }
+      // was there a problem on this layer?
+      if (!ok) { // may fail to reach target layer due to the eloss
+	double rad2 = probTr[it].GetX()*probTr[it].GetX() + probTr[it].GetY()*probTr[it].GetY();
+	if (rad2 - minRad*minRad < kTrackingMargin*kTrackingMargin) { // check previously reached layer
+	  active[it] = kFALSE; // did not reach min requested layer
+	}
+	outward[it] = kFALSE;
+	continue;
+      }
+      probTr[it] = probTrLast;
+      lastReachedLayer[it] = il;
     }
-    probTr = probTrLast;
-    lastReachedLayer = il;
   }
-  // do tiny overshoot for the safety of the back-propagation
-  if (!PropagateToR(&probTr,probTr.GetX() + kTrackingMargin,bGauss,1)) return kFALSE;
-  if (!probTr.Rotate(probTr.PhiPos())) return kFALSE;
   //
   const double kLargeErr2Coord = 5*5;
   const double kLargeErr2Dir = 0.7*0.7;
   const double kLargeErr2PtI = 30.5*30.5;
-  for (int ic=15;ic--;) trCov[ic] = 0.;
-  trCov[kY2]   = trCov[kZ2]   = kLargeErr2Coord; 
-  trCov[kSnp2] = trCov[kTgl2] = kLargeErr2Dir;
-  trCov[kPtI2] = kLargeErr2PtI*trPars[kPtI]*trPars[kPtI];
-  probTr.CheckCovariance();
+  Int_t maxReachedLayer = -1;
+  for (int it = 0; it < n; ++it) {
+    if (!active[it]) continue;
+    // do tiny overshoot for the safety of the back-propagation
+    if (!PropagateToR(&probTr[it],probTr[it].GetX() + kTrackingMargin,bGauss,1) || !probTr[it].Rotate(probTr[it].PhiPos())) {
+      active[it] = kFALSE;
+      continue;
+    }
+    //
+    double *trPars = (double*)probTr[it].GetParameter();
+    double *trCov  = (double*)probTr[it].GetCovariance();
+    for (int ic=15;ic--;) trCov[ic] = 0.;
+    trCov[kY2]   = trCov[kZ2]   = kLargeErr2Coord; 
+    trCov[kSnp2] = trCov[kTgl2] = kLargeErr2Dir;
+    trCov[kPtI2] = kLargeErr2PtI*trPars[kPtI]*trPars[kPtI];
+    probTr[it].CheckCovariance();
+    maxReachedLayer = TMath::Max(maxReachedLayer, lastReachedLayer[it]);
+  }
   //
   // Back-propagate the covariance matrix along the track.   
   CylLayerK *layer = 0;
   //
-  for (Int_t j=lastReachedLayer+1; j--;) {  // Layer loop
+  for (Int_t j=maxReachedLayer+1; j--;) {  // Layer loop
     
-    layer = (CylLayerK*)fLayers.At(j);
+    layer = layers[j].layer;
     
     if (layer->radius>fMaxSeedRadius) continue; // no seeding beyond this radius 
     
-    TString name(layer->GetName());
-    Bool_t isVertex = name.Contains("vertex");
-    Bool_t isTOF = name.Contains("tof");
-    //
-    if (!PropagateToR(&probTr,layer->radius,bGauss,-1)) return kFALSE; //exit(1);
-    if (!isVertex) {
-      double pos[3];
-      probTr.GetXYZ(pos);  // lab position
-      double phi = TMath::ATan2(pos[1],pos[0]);
-      if ( TMath::Abs(TMath::Abs(phi)-TMath::Pi()/2)<1e-3) phi = 0;//TMath::Sign(TMath::Pi()/2 - 1e-3,phi);
-      if (!probTr.Rotate(phi)) {
-	printf("Failed to rotate to the frame (phi:%+.3f)of layer at %.2f at XYZ: %+.3f %+.3f %+.3f (pt=%+.3f)\n",
-	       phi,layer->radius,pos[0],pos[1],pos[2],pt);	
-	probTr.Print();
-	return kFALSE; // exit(1);
-      }
-    }
-    // save inward parameters at this layer: before the update!
-    new( saveParInward[j] ) AliExternalTrackParam(probTr);
-    if (verboseR) {
-      printf("SaveInw %d (%f)  ",j,layer->radius); probTr.Print();
-    }    
+    Bool_t isVertex = layers[j].isVertex;
+    Bool_t isTOF = layers[j].isTOF;
+    Bool_t isInside = layer->radius < fProductionRadius;
     //
-    if (!isVertex && !isTOF && !layer->isDead) {
+    for (int it = 0; it < n; ++it) {
+      if (!active[it] || j > lastReachedLayer[it]) continue;
+      AliExternalTrackParam &tr = probTr[it];
+      double mass = ts[it]->fMass;
+      active[it] = kFALSE; // until this layer is done
       //
-      // create fake measurement with the errors assigned to the layer
-      // account for the measurement there 
-      double meas[2] = {probTr.GetY(),probTr.GetZ()};
-      double measErr2[3] = {layer->phiRes*layer->phiRes,0,layer->zRes*layer->zRes};
+      if (!PropagateToR(&tr,layer->radius,bGauss,-1)) continue; //exit(1);
+      if (!isVertex) {
+	double pos[3];
+	tr.GetXYZ(pos);  // lab position
+	double phi = TMath::ATan2(pos[1],pos[0]);
+	if ( TMath::Abs(TMath::Abs(phi)-TMath::Pi()/2)<1e-3) phi = 0;//TMath::Sign(TMath::Pi()/2 - 1e-3,phi);
+	if (!tr.Rotate(phi)) {
+	  printf("Failed to rotate to the frame (phi:%+.3f)of layer at %.2f at XYZ: %+.3f %+.3f %+.3f (pt=%+.3f)\n",
+		 phi,layer->radius,pos[0],pos[1],pos[2],pt[it]);	
+	  tr.Print();
+	  continue; // exit(1);
+	}
+      }
+      // save inward parameters at this layer: before the update!
+      new( ts[it]->fTrackInw[j] ) AliExternalTrackParam(tr);
+      if (verboseR) {
+	printf("SaveInw %d (%f)  ",j,layer->radius); tr.Print();
+      }    
       //
-      if (!probTr.Update(meas,measErr2)) {
-	printf("Failed to update the track by measurement {%.3f,%3f} err {%.3e %.3e %.3e}\n",
-	       meas[0],meas[1], measErr2[0],measErr2[1],measErr2[2]);
-	probTr.Print();
-	return kFALSE; // exit(1);
+      if (!isVertex && !isTOF && !layer->isDead && !isInside) {
+	//
+	// create fake measurement with the errors assigned to the layer
+	// account for the measurement there 
+	double meas[2] = {tr.GetY(),tr.GetZ()};
+	double measErr2[3] = {layer->phiRes*layer->phiRes,0,layer->zRes*layer->zRes};
+	//
+	if (!tr.Update(meas,measErr2)) {
+	  printf("Failed to update the track by measurement {%.3f,%3f} err {%.3e %.3e %.3e}\n",
+		 meas[0],meas[1], measErr2[0],measErr2[1],measErr2[2]);
+	  tr.Print();
+	  continue; // exit(1);
+	}
       }
-    }
-    // correct for materials of this layer
-    // note: if apart from MS we want also e.loss correction, the density*length should be provided as 2nd param
-    if (layer->radL>0 && !probTr.CorrectForMeanMaterial(layer->radL, 0, mass , kTRUE)) {
-      printf("Failed to apply material correction, X/X0=%.4f\n",layer->radL);
-      probTr.Print();
-      return kFALSE; // exit(1);
-    }
-    if (layer->xrho>0) { // correct in small steps
-      for (int ise=xrhosteps;ise--;) {
-	if (!probTr.CorrectForMeanMaterial(0, layer->xrho/xrhosteps, mass , kTRUE)) {
-	  printf("Failed to apply material correction, xrho=%.4f\n",layer->xrho);
-	  probTr.Print();
-	  return kFALSE; // exit(1);
+      // correct for materials of this layer
+      // note: if apart from MS we want also e.loss correction, the density*length should be provided as 2nd param
+      if (!isInside && layer->radL>0 && !tr.CorrectForMeanMaterial(layer->radL, 0, mass , kTRUE)) {
+	printf("Failed to apply material correction, X/X0=%.4f\n",layer->radL);
+	tr.Print();
+	continue; // exit(1);
+      }
+      Bool_t ok = kTRUE;
+      if (!isInside && layer->xrho>0) { // correct in small steps
+	for (int ise=xrhosteps;ise--;) {
+	  if (!tr.CorrectForMeanMaterial(0, layer->xrho/xrhosteps, mass , kTRUE)) {
+	    printf("Failed to apply material correction, xrho=%.4f\n",layer->xrho);
+	    tr.Print();
+	    ok = kFALSE; // exit(1);
+	    break;
+	  }
 	}
       }
+      active[it] = ok;
     }
   }
   //  
@@ -1621,104 +1734,112 @@ Bool_t DetectorK::SolveTrack(TrackSol& ts) {
   
   // RESET Covariance Matrix ( to 10 x the estimate -> as it is done in AliExternalTrackParam)
   //	mIstar.UnitMatrix(); // start with unity
-  if (doLikeAliRoot) {
-    probTr.ResetCovariance(100);
-  } else {
-    // cannot do complete reset, set to very large errors
-    for (int ic=15;ic--;) trCov[ic] = 0.;
-    trCov[kY2]   = trCov[kZ2]   = kLargeErr2Coord; 
-    trCov[kSnp2] = trCov[kTgl2] = kLargeErr2Dir;
-    trCov[kPtI2] = kLargeErr2PtI*trPars[kPtI]*trPars[kPtI];
-    probTr.CheckCovariance();
-  }    
-  // find first "active layer" - start tracking at the first active layer      
-  Int_t firstActiveLayer = 0;
-  for (Int_t j=0; j<=lastActiveLayer; j++) { 
-    layer = (CylLayerK*)fLayers.At(j);
-    if (!(layer->isDead)) { // is alive
-      firstActiveLayer = j;
-      break;
+  for (int it = 0; it < n; ++it) {
+    if (!active[it]) continue;
+    if (doLikeAliRoot) {
+      probTr[it].ResetCovariance(100);
+    } else {
+      // cannot do complete reset, set to very large errors
+      double *trPars = (double*)probTr[it].GetParameter();
+      double *trCov  = (double*)probTr[it].GetCovariance();
+      for (int ic=15;ic--;) trCov[ic] = 0.;
+      trCov[kY2]   = trCov[kZ2]   = kLargeErr2Coord; 
+      trCov[kSnp2] = trCov[kTgl2] = kLargeErr2Dir;
+      trCov[kPtI2] = kLargeErr2PtI*trPars[kPtI]*trPars[kPtI];
+      probTr[it].CheckCovariance();
     }
   }
   //probTr.Rotate(0);
-  for (Int_t j=0; j<=lastReachedLayer; j++) {  // Layer loop
-    //
-    layer = (CylLayerK*)fLayers.At(j);
-    TString name(layer->GetName());
-    Bool_t isVertex = name.Contains("vertex");
-    Bool_t isTOF = name.Contains("tof");
-    if (!PropagateToR(&probTr, layer->radius,bGauss,1)) return kFALSE;//exit(1);
+  for (Int_t j=0; j<=maxReachedLayer; j++) {  // Layer loop
     //
-    if (!isVertex) {
-      // rotate to frame with X axis normal to the surface
-      double pos[3];
-      probTr.GetXYZ(pos);  // lab position
-      double phi = TMath::ATan2(pos[1],pos[0]);
-      if ( TMath::Abs(TMath::Abs(phi)-TMath::Pi()/2)<1e-3) phi = 0;//TMath::Sign(TMath::Pi()/2 - 1e-3,phi);
-      if (!probTr.Rotate(phi)) {
-	printf("Failed to rotate to the frame (phi:%+.3f)of layer at %.2f at XYZ: %+.3f %+.3f %+.3f (pt=%+.3f)\n",
-	       phi,layer->radius,pos[0],pos[1],pos[2],pt);	      
-	probTr.Print();
-	return kFALSE; // exit(1);
+    layer = layers[j].layer;
+    Bool_t isVertex = layers[j].isVertex;
+    Bool_t isTOF = layers[j].isTOF;
+    Bool_t isInside = layer->radius < fProductionRadius;
+    for (int it = 0; it < n; ++it) {
+      if (!active[it] || j > lastReachedLayer[it]) continue;
+      AliExternalTrackParam &tr = probTr[it];
+      double mass = ts[it]->fMass;
+      active[it] = kFALSE; // until this layer is done
+      if (!PropagateToR(&tr, layer->radius,bGauss,1)) continue;//exit(1);
+      //
+      if (!isVertex) {
+	// rotate to frame with X axis normal to the surface
+	double pos[3];
+	tr.GetXYZ(pos);  // lab position
+	double phi = TMath::ATan2(pos[1],pos[0]);
+	if ( TMath::Abs(TMath::Abs(phi)-TMath::Pi()/2)<1e-3) phi = 0;//TMath::Sign(TMath::Pi()/2 - 1e-3,phi);
+	if (!tr.Rotate(phi)) {
+	  printf("Failed to rotate to the frame (phi:%+.3f)of layer at %.2f at XYZ: %+.3f %+.3f %+.3f (pt=%+.3f)\n",
+		 phi,layer->radius,pos[0],pos[1],pos[2],pt[it]);	      
+	  tr.Print();
+	  continue; // exit(1);
+	}
       }
-    }
-    //
-    // save outward parameters at this layer: before the update
-    new( saveParOutwardB[j] ) AliExternalTrackParam(probTr);
-    //
-    // combined in-out prediction
-    new( saveParComb[j]  ) AliExternalTrackParam(*(AliExternalTrackParam*)saveParInward[j]);
-    double *covInw = (double*) ((AliExternalTrackParam*)saveParInward[j])->GetCovariance();
-    double *covOut = (double*) probTr.GetCovariance();
-    double *covCmb = (double*) ((AliExternalTrackParam*)saveParComb[j])->GetCovariance();
-    covCmb[0] = covInw[0]*covOut[0]/(covInw[0]+covOut[0]);
-    covCmb[2] = covInw[2]*covOut[2]/(covInw[2]+covOut[2]);
-    covCmb[1] = 0;
-    // create fake measurement with the errors assigned to the layer
-    // account for the measurement there
-    if (!isVertex && !isTOF && !layer->isDead) {
-      double meas[2] = {probTr.GetY(),probTr.GetZ()};
-      double measErr2[3] = {layer->phiRes*layer->phiRes,0,layer->zRes*layer->zRes};
       //
-      if (!probTr.Update(meas,measErr2)) {
-	printf("Failed to update the track by measurement {%.3f,%3f} err {%.3e %.3e %.3e}\n",
-	       meas[0],meas[1], measErr2[0],measErr2[1],measErr2[2]);
-	probTr.Print();
-	return kFALSE; // exit(1);
+      // save outward parameters at this layer: before the update
+      new( ts[it]->fTrackOutB[j] ) AliExternalTrackParam(tr);
+      //
+      // combined in-out prediction
+      new( ts[it]->fTrackCmb[j]  ) AliExternalTrackParam(*(AliExternalTrackParam*)ts[it]->fTrackInw[j]);
+      double *covInw = (double*) ((AliExternalTrackParam*)ts[it]->fTrackInw[j])->GetCovariance();
+      double *covOut = (double*) tr.GetCovariance();
+      double *covCmb = (double*) ((AliExternalTrackParam*)ts[it]->fTrackCmb[j])->GetCovariance();
+      covCmb[0] = covInw[0]*covOut[0]/(covInw[0]+covOut[0]);
+      covCmb[2] = covInw[2]*covOut[2]/(covInw[2]+covOut[2]);
+      covCmb[1] = 0;
+      // create fake measurement with the errors assigned to the layer
+      // account for the measurement there
+      if (!isVertex && !isTOF && !layer->isDead && !isInside) {
+	double meas[2] = {tr.GetY(),tr.GetZ()};
+	double measErr2[3] = {layer->phiRes*layer->phiRes,0,layer->zRes*layer->zRes};
+	//
+	if (!tr.Update(meas,measErr2)) {
+	  printf("Failed to update the track by measurement {%.3f,%3f} err {%.3e %.3e %.3e}\n",
+		 meas[0],meas[1], measErr2[0],measErr2[1],measErr2[2]);
+	  tr.Print();
+	  continue; // exit(1);
+	}
       }
-    }
-    // note: if apart from MS we want also e.loss correction, the density*length should be provided as 2nd param
-    if (layer->radL>0 && !probTr.CorrectForMeanMaterial(layer->radL, 0, mass , kTRUE)) {
-      printf("Failed to apply material correction, X/X0=%.4f\n",layer->radL);
-      probTr.Print();
-      return kFALSE; // exit(1);
-    }
-    if (layer->xrho>0) { // correct in small steps
-      for (int ise=xrhosteps;ise--;) {
-	if (!probTr.CorrectForMeanMaterial(0, -layer->xrho/xrhosteps, mass , kTRUE)) {
-	  printf("Failed to apply material correction, xrho=%.4f\n",-layer->xrho);
-	  probTr.Print();
-	  return kFALSE; // exit(1);
+      // note: if apart from MS we want also e.loss correction, the density*length should be provided as 2nd param
+      if (!isInside && layer->radL>0 && !tr.CorrectForMeanMaterial(layer->radL, 0, mass , kTRUE)) {
+	printf("Failed to apply material correction, X/X0=%.4f\n",layer->radL);
+	tr.Print();
+	continue; // exit(1);
+      }
+      Bool_t ok = kTRUE;
+      if (!isInside && layer->xrho>0) { // correct in small steps
+	for (int ise=xrhosteps;ise--;) {
+	  if (!tr.CorrectForMeanMaterial(0, -layer->xrho/xrhosteps, mass , kTRUE)) {
+	    printf("Failed to apply material correction, xrho=%.4f\n",-layer->xrho);
+	    tr.Print();
+	    ok = kFALSE; // exit(1);
+	    break;
+	  }
 	}
       }
-    }
-    // save outward parameters at this layer: after the update
-    new( saveParOutwardA[j] ) AliExternalTrackParam(probTr);
-    //
-    // good hit probability calculation
-    if (!isVertex && !layer->isDead) {
-      AliExternalTrackParam* trCmb = (AliExternalTrackParam*)ts.fTrackCmb[j];
-      double sigYCmb = TMath::Sqrt(trCmb->GetSigmaY2()+layer->phiRes*layer->phiRes);
-      double sigZCmb = TMath::Sqrt(trCmb->GetSigmaZ2()+layer->zRes*layer->zRes);
-      fGoodHitProb[j] = ProbGoodChiSqHit(layer->radius * 100., sigYCmb * 100., sigZCmb * 100.);
-      if (!isTOF)
-        fGoodHitProb[0]  *= fGoodHitProb[j];
+      if (!ok) continue;
+      // save outward parameters at this layer: after the update
+      new( ts[it]->fTrackOutA[j] ) AliExternalTrackParam(tr);
+      //
+      // good hit probability calculation
+      if (!isVertex && !layer->isDead && !isInside) {
+	AliExternalTrackParam* trCmb = (AliExternalTrackParam*)ts[it]->fTrackCmb[j];
+	double sigYCmb = TMath::Sqrt(trCmb->GetSigmaY2()+layer->phiRes*layer->phiRes);
+	double sigZCmb = TMath::Sqrt(trCmb->GetSigmaZ2()+layer->zRes*layer->zRes);
+	Double_t *goodHitProb = ts[it]->fGoodHitProb;
+	goodHitProb[j] = ProbGoodChiSqHit(layer->radius * 100., sigYCmb * 100., sigZCmb * 100.);
+	if (!isTOF)
+	  goodHitProb[0]  *= goodHitProb[j];
+      }
+      active[it] = kTRUE;
     }
   }
-  //
-  probTr.SetUseLogTermMS(kFALSE); // Reset of MS term usage to avoid problems since its static
   //  
-  return kTRUE;
+  Int_t nSolved = 0;
+  for (int it = 0; it < n; ++it)
+    if ((solved[it] = active[it])) nSolved++;
+  return nSolved;
 }
 
 Bool_t DetectorK::CalcITSEff(TrackSol& ts, Bool_t verbose)
@@ -1726,17 +1847,9 @@ Bool_t DetectorK::CalcITSEff(TrackSol& ts, Bool_t verbose)
   // Prepare Probability Kombinations
   Int_t nLayer = fNumberOfActiveITSLayers;
   Int_t base = 3; // null, fake, correct
-  Int_t komb = (Int_t) TMath::Power(base,nLayer);
   TMatrixD probLayInw(base,fNumberOfActiveITSLayers);
   TMatrixD probLayOut(base,fNumberOfActiveITSLayers);
   TMatrixD probLayCmb(base,fNumberOfActiveITSLayers);
-  TMatrixD probKomb(komb,nLayer);
-  for (Int_t num=0; num<komb; num++) {
-    for (Int_t l=nLayer; l--;) {
-      Int_t pow = ((Int_t)TMath::Power(base,l+1));
-      probKomb(num,nLayer-1-l)=(num%pow)/((Int_t)TMath::Power(base,l));
-    }
-  }
   int nITSAct=0, ilr=0;
   if (verbose) printf("Lr:  \t rad   x/x0   h.dens | Inw sY sZ  ->  Pr.Corr | Out sY sZ  ->  Pr.Corr | Cmb sY sZ  ->  Pr.Corr |\n");
 
@@ -1782,9 +1895,9 @@ Bool_t DetectorK::CalcITSEff(TrackSol& ts, Bool_t verbose)
     ilr++;
     //
   }
-  PrepareEffFakeKombinations(&probKomb,&probLayInw,nLayer,(double*)ts.fProb[TrackSol::kInw]);
-  PrepareEffFakeKombinations(&probKomb,&probLayOut,nLayer,(double*)ts.fProb[TrackSol::kOut]);
-  PrepareEffFakeKombinations(&probKomb,&probLayCmb,nLayer,(double*)ts.fProb[TrackSol::kCmb]);
+  PrepareEffFakeKombinations(&probLayInw,nLayer,(double*)ts.fProb[TrackSol::kInw]);
+  PrepareEffFakeKombinations(&probLayOut,nLayer,(double*)ts.fProb[TrackSol::kOut]);
+  PrepareEffFakeKombinations(&probLayCmb,nLayer,(double*)ts.fProb[TrackSol::kCmb]);
   if (verbose) {
     printf("Corr/Fake probs:             |    %.4f/%.4f       |     %.4f/%.4f      |     %.4f/%.4f\n",
 	   ts.fProb[TrackSol::kInw][0],ts.fProb[TrackSol::kInw][1],
@@ -2523,66 +2636,60 @@ Bool_t DetectorK::GetXatLabR(AliExternalTrackParam* tr,Double_t r,Double_t &x, D
 
 
 
-Double_t* DetectorK::PrepareEffFakeKombinations(TMatrixD *probKomb, TMatrixD *probLay, int nLayer, double *probs) {
+Double_t* DetectorK::PrepareEffFakeKombinations(TMatrixD *probLay, int nLayer, double *probs) const {
+  //
+  // Probabilities of an efficient track (at least fAtLeastCorr correct and no fake hits) and of a fake
+  // track (at least fAtLeastFake fake hits), both with at least fAtLeastHits hits.
+  // Instead of walking the 3^nLayer outcomes, the distributions of the number of correct and fake hits
+  // are built layer by layer.
 
   if (!probLay) {  
     printf("Error: Layer tracking efficiencies not set \n");
     return 0;
   }
 
-  TMatrixD &tProbKomb = *probKomb;
   TMatrixD &tProbLay = *probLay;
 
-
-  //  Int_t base = tProbLay.GetNcols(); // 3? null, fake, correct
-  //  Int_t nLayer = tProbKomb.GetNcols(); // nlayer? - number of ITS layers
-  Int_t komb = tProbKomb.GetNrows(); // 3^nlayer? - number of kombinations
-
-  // Fill probabilities 
-
-  Double_t probEff =0;
-  Double_t probFake =0;
-  for (Int_t num=0; num<komb; num++) {
-    Int_t flCorr=0, flFake=0, flNull=0; 
-    for (Int_t l=0; l<nLayer; l++)  {
-      if (tProbKomb(num,l)==0) 
-	flNull++;
-      else if (tProbKomb(num,l)==1)
-	flFake++;
-      else if (tProbKomb(num,l)==2)
-	flCorr++;
-      else 
-	printf("Error: unexpected values in combinatorics table\n");
-    }
-
-    Int_t fkAtLeastHits = fAtLeastHits;
-    Int_t fkAtLeastCorr = fAtLeastCorr;
-    if (fAtLeastHits == -1) fkAtLeastHits = nLayer; // all hits are "correct"
-    if (fAtLeastCorr == -1) fkAtLeastCorr = nLayer; // all hits are "correct"
-    //
-    if (flCorr+flFake < fAtLeastHits) continue;
-
-    if (flCorr>=fkAtLeastCorr && flFake==0) { // at least correct but zero fake
-      Double_t probEffLayer = 1;
-      for (Int_t l=0; l<nLayer; l++) {
-	probEffLayer *=  tProbLay((Int_t)tProbKomb(num,l),l);
-	//	cout<<a(num,l)<<" ";
-      }
-      //      cout<<endl;
-      probEff+=probEffLayer;
+  Int_t fkAtLeastCorr = fAtLeastCorr;
+  if (fAtLeastCorr == -1) fkAtLeastCorr = nLayer; // all hits are "correct"
+
+  // the number of hits only matters for fakes when not implied by the number of fakes
+  const Bool_t hitsCut = fAtLeastHits > TMath::Max(fAtLeastFake, 0);
+  const Int_t nh = hitsCut ? nLayer + 1 : 1, nf = nLayer + 1;
+  std::vector<Double_t> corr(nf, 0.), corrNext(nf);          // [correct] with no fakes
+  std::vector<Double_t> fake(nh * nf, 0.), fakeNext(nh * nf); // [hits][fakes]
+  corr[0] = fake[0] = 1.;
+  for (Int_t l=0; l<nLayer; l++) {
+    const Double_t pNull = tProbLay(0,l), pFake = tProbLay(1,l), pCorr = tProbLay(2,l);
+    std::fill(corrNext.begin(), corrNext.end(), 0.);
+    for (Int_t c=0; c<=l; c++) {
+      corrNext[c]   += corr[c] * pNull;
+      corrNext[c+1] += corr[c] * pCorr;
     }
- 
-    if (flFake>=fAtLeastFake) {
-      Double_t probFakeLayer = 1;
-      for (Int_t l=0; l<nLayer; l++) {
-	probFakeLayer *=  tProbLay((Int_t)tProbKomb(num,l),l);
-	//	cout<<a(num,l)<<" ";
+    std::fill(fakeNext.begin(), fakeNext.end(), 0.);
+    // at most l hits after l layers, so that hNext stays below nh
+    const Int_t hMax = hitsCut ? l : 0;
+    for (Int_t h=0; h<=hMax; h++) {
+      const Int_t hNext = hitsCut ? h + 1 : 0;
+      for (Int_t f=0; f<=l; f++) {
+	const Double_t prob = fake[h * nf + f];
+	fakeNext[h * nf + f]         += prob * pNull;
+	fakeNext[hNext * nf + f + 1] += prob * pFake;
+	fakeNext[hNext * nf + f]     += prob * pCorr;
       }
-      //      cout<<endl;
-      probFake+=probFakeLayer;
     }
-
+    corr.swap(corrNext);
+    fake.swap(fakeNext);
   }
+
+  Double_t probEff =0;
+  Double_t probFake =0;
+  for (Int_t c=TMath::Max(TMath::Max(fAtLeastHits, fkAtLeastCorr), 0); c<=nLayer; c++)
+    probEff += corr[c];
+  for (Int_t h=(hitsCut ? fAtLeastHits : 0); h<nh; h++)
+    for (Int_t f=TMath::Max(fAtLeastFake, 0); f<=nLayer; f++)
+      probFake += fake[h * nf + f];
+
   if (!probs) probs = new Double_t[2];
   probs[0] = probEff; probs[1] = probFake;
   return probs;
@@ -2592,7 +2699,7 @@ Double_t* DetectorK::PrepareEffFakeKombinations(TMatrixD *probKomb, TMatrixD *pr
 //____________________________________
 Bool_t DetectorK::PropagateToR(AliExternalTrackParam* trc, double r, double b, int dir, double maxStep) 
 {
-  // go to radius R
+  // go to radius R, in a single helix step when the track stays within the local frame
   //
   double xToGo = 0;
   double rr = r*r;
@@ -2612,7 +2719,8 @@ Bool_t DetectorK::PropagateToR(AliExternalTrackParam* trc, double r, double b, i
   
     Double_t xpos = trc->GetX();
     dir = (xpos<xToGo) ? 1:-1;
-    while ( (xToGo-xpos)*dir > kEpsilonX) {
+    if (PropagateHelixTo(trc,xToGo,b)) xpos = trc->GetX(); // single analytic step
+    while ( (xToGo-xpos)*dir > kEpsilonX) {                // stepping fallback
       Double_t step = dir*TMath::Min(TMath::Abs(xToGo-xpos), maxStep);
       Double_t x    = xpos+step;
       //      Double_t xyz0[3],xyz1[3],param[7];
@@ -2649,6 +2757,54 @@ Bool_t DetectorK::PropagateToR(AliExternalTrackParam* trc, double r, double b, i
 }
 
 
+//____________________________________
+Bool_t DetectorK::PropagateHelixTo(AliExternalTrackParam* trc, double x, double b)
+{
+  // Propagate the track to local X in one step, transporting the parameters and the
+  // covariance along the exact helix in the current frame (no material)
+  //
+  const double *par = trc->GetParameter();
+  double dx = x - trc->GetX();
+  if (TMath::Abs(dx)<kAlmost0) return kTRUE;
+  double k = b*kB2C;                    // curvature per unit q/pt
+  double f1 = par[2], f2 = f1 + par[4]*k*dx;
+  if (TMath::Abs(f1)>=kAlmost1 || TMath::Abs(f2)>=kAlmost1) return kFALSE;
+  double r1 = TMath::Sqrt((1.-f1)*(1.+f1)), r2 = TMath::Sqrt((1.-f2)*(1.+f2));
+  double phi1 = TMath::ASin(f1), phi2 = TMath::ASin(f2);
+  double phim = 0.5*(phi1+phi2), u = 0.5*(phi2-phi1); // mean direction and half turning angle
+  double cm = TMath::Cos(phim), tm = TMath::Tan(phim);
+  double s, ds;                         // u/sin(u) and its derivative
+  if (TMath::Abs(u)<1e-3) { s = 1.+u*u/6.; ds = u/3.; }
+  else { double su = TMath::Sin(u); s = u/su; ds = (su-u*TMath::Cos(u))/(su*su); }
+  double arc = dx*s/cm;                 // path length in the bending plane
+  //
+  // jacobian: dy = dx*tan(phim), dz = tgl*arc
+  double dmdf = 0.5*(1./r1+1./r2), dudf = 0.5*(1./r2-1./r1), dmdc = 0.5*dx/r2;
+  double dydm = dx/(cm*cm), dzdm = par[3]*arc*tm, dzdu = par[3]*dx*ds/cm;
+  double jac[5][5] = {{1,0,0,0,0},{0,1,0,0,0},{0,0,1,0,0},{0,0,0,1,0},{0,0,0,0,1}};
+  jac[0][2] = dydm*dmdf;
+  jac[0][4] = dydm*dmdc*k;
+  jac[1][2] = dzdm*dmdf + dzdu*dudf;
+  jac[1][3] = arc;
+  jac[1][4] = (dzdm + dzdu)*dmdc*k;
+  jac[2][4] = dx*k;
+  //
+  double parNew[5] = {par[0] + dx*tm, par[1] + par[3]*arc, f2, par[3], par[4]};
+  const double *cov = trc->GetCovariance();
+  double c[5][5], jc[5][5], covNew[15];
+  for (int i=0,ij=0;i<5;i++) for (int j=0;j<=i;j++,ij++) c[i][j] = c[j][i] = cov[ij];
+  for (int i=0;i<5;i++) for (int j=0;j<5;j++) {
+    jc[i][j] = 0;
+    for (int l=0;l<5;l++) jc[i][j] += jac[i][l]*c[l][j];
+  }
+  for (int i=0,ij=0;i<5;i++) for (int j=0;j<=i;j++,ij++) {
+    covNew[ij] = 0;
+    for (int l=0;l<5;l++) covNew[ij] += jc[i][l]*jac[j][l];
+  }
+  trc->Set(x, trc->GetAlpha(), parNew, covNew);
+  return kTRUE;
+}
+
 //_________________________________________
 Bool_t DetectorK::IsITSLayer(const TString &lname)
 {
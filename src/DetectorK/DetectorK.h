@@ -6,6 +6,8 @@
 #include <TList.h>
 #include <TGraph.h>
 #include <Riostream.h>
+#include <map>
+#include <vector>
 #include "HistoManager.h"
 
 /***********************************************************
@@ -54,6 +56,7 @@ class TrackSol: public TObject
 {
  public:
   enum {kInw,kOut,kCmb};
+  enum {kMaxLayers = 200};
   //
  TrackSol(int nL, double pt, double eta, int q, double m=0.140) 
    : fPt(nL>0 ? pt : -1), fEta(eta), fMass(m), fCharge(q),  
@@ -63,6 +66,7 @@ class TrackSol: public TObject
     fTrackCmb("AliExternalTrackParam",nL)
     {
       for (int i=3;i--;) fProb[i][0] = fProb[i][1] = 0;
+      for (int i=kMaxLayers;i--;) fGoodHitProb[i] = -1;
     }
   //
   void Clear(Option_t*) {
@@ -79,12 +83,13 @@ class TrackSol: public TObject
   Double_t        fMass;
   Int_t           fCharge;
   Double_t        fProb[3][2]; // corr/fake prob for inw,out and cmb tracking
+  Double_t        fGoodHitProb[kMaxLayers]; // good hit prob per layer, layer 0 accumulates
   TClonesArray fTrackInw;
   TClonesArray fTrackOutB; // outward before update
   TClonesArray fTrackOutA; // outward after update
   TClonesArray fTrackCmb;
   //
-  ClassDef(TrackSol,1)
+  ClassDef(TrackSol,2)
 };
 
 
@@ -108,6 +113,12 @@ public:
  ClassDef(CylLayerK,1);
 };
 
+struct SolverLayerK {
+  CylLayerK *layer;  // geometry, only read while solving
+  Bool_t isVertex;   // layer types, resolved once from the name
+  Bool_t isTOF;
+};
+
 
 class DetectorK : public TNamed {
 
@@ -136,6 +147,7 @@ class DetectorK : public TNamed {
   Float_t GetLayerEfficiency(char *name);
 
   void PrintLayout(Bool_t full = kFALSE); 
+  TString GetLayoutKey() const;
   void PlotLayout(Int_t plotDead = kTRUE);
   
   void MakeAliceAllNew(Bool_t flagTPC =1,Bool_t flagMon=1);
@@ -146,17 +158,17 @@ class DetectorK : public TNamed {
 
   void SetBField(Float_t bfield) {fBField = bfield; }
   Float_t GetBField() const {return fBField; }
-  void SetLhcUPCscale(Float_t lhcUPCscale) {fLhcUPCscale = lhcUPCscale; }
+  void SetLhcUPCscale(Float_t lhcUPCscale) {fLhcUPCscale = lhcUPCscale; UpdateHitDensity(); }
   Float_t GetLhcUPCscale() const { return fLhcUPCscale; }
   void SetParticleMass(Float_t particleMass) {fParticleMass = particleMass; }
   Float_t GetParticleMass() const { return fParticleMass; }
   void SetMaxSnp(Float_t snp = 0.85) {fMaxSnp = snp; }
   Float_t GetMaxSnp() const {return fMaxSnp;}
-  void SetIntegrationTime(Float_t integrationTime) {fIntegrationTime = integrationTime; }
+  void SetIntegrationTime(Float_t integrationTime) {fIntegrationTime = integrationTime; UpdateHitDensity(); }
   Float_t GetIntegrationTime() const { return fIntegrationTime; }
-  void SetMaxRadiusOfSlowDetectors(Float_t maxRadiusSlowDet) {fMaxRadiusSlowDet =  maxRadiusSlowDet; }
+  void SetMaxRadiusOfSlowDetectors(Float_t maxRadiusSlowDet) {fMaxRadiusSlowDet =  maxRadiusSlowDet; UpdateHitDensity(); }
   Float_t GetMaxRadiusOfSlowDetectors() const { return fMaxRadiusSlowDet; }
-  void SetAvgRapidity(Float_t avgRapidity) {fAvgRapidity = avgRapidity; }
+  void SetAvgRapidity(Float_t avgRapidity) {fAvgRapidity = avgRapidity; UpdateHitDensity(); }
   Float_t GetAvgRapidity() const { return fAvgRapidity; }
   void SetConfidenceLevel(Float_t confLevel) {fConfLevel = confLevel; }
   Float_t GetConfidenceLevel() const { return fConfLevel; }
@@ -177,7 +189,7 @@ class DetectorK : public TNamed {
 
   
 
-  void SetdNdEtaCent(Int_t dNdEtaCent ) {fdNdEtaCent = dNdEtaCent; }
+  void SetdNdEtaCent(Int_t dNdEtaCent ) {fdNdEtaCent = dNdEtaCent; UpdateHitDensity(); }
   Float_t GetdNdEtaCent() const { return fdNdEtaCent; }
   
   
@@ -187,27 +199,34 @@ class DetectorK : public TNamed {
 
   void SolveViaBilloir(Double_t selPt =0.1, double ptmin=-1);
   //
-  Bool_t SolveTrack(TrackSol& ts);
+  Bool_t SolveTrack(TrackSol& ts) const; // reentrant, results are stored in ts
+  Int_t  SolveTracks(TrackSol** ts, Int_t n, Bool_t* solved) const; // pack of tracks in one call, same results as SolveTrack
   Bool_t CalcITSEff(TrackSol& ts, Bool_t verbose=kTRUE);
   Bool_t ExtrapolateToR(AliExternalTrackParam* probTr, double rTgt, double mass=0.14);
   //
   void   SetMinRadTrack(double r=132) {  fMinRadTrack = r; }
   Double_t GetMinRadTrack()  const { return fMinRadTrack;}
+  void   SetProductionRadius(double r=0) {  fProductionRadius = r; }
+  Double_t GetProductionRadius()  const { return fProductionRadius;}
 
   //
   //
   // Helper functions
   Double_t ThetaMCS                 ( Double_t mass, Double_t RadLength, Double_t momentum ) const;
-  Double_t ProbGoodHit              ( Double_t radius, Double_t searchRadiusRPhi, Double_t searchRadiusZ )   ; 
-  Double_t ProbGoodChiSqHit         ( Double_t radius, Double_t searchRadiusRPhi, Double_t searchRadiusZ )   ; 
-  Double_t ProbGoodChiSqPlusConfHit ( Double_t radius, Double_t leff, Double_t searchRadiusRPhi, Double_t searchRadiusZ )   ; 
-  Double_t ProbNullChiSqPlusConfHit ( Double_t radius, Double_t leff, Double_t searchRadiusRPhi, Double_t searchRadiusZ )   ; 
+  Double_t ProbGoodHit              ( Double_t radius, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) const  ; 
+  Double_t ProbGoodChiSqHit         ( Double_t radius, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) const  ; 
+  Double_t ProbGoodChiSqPlusConfHit ( Double_t radius, Double_t leff, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) const  ; 
+  Double_t ProbNullChiSqPlusConfHit ( Double_t radius, Double_t leff, Double_t searchRadiusRPhi, Double_t searchRadiusZ ) const  ; 
  
   // Howard W. hit distribution and convolution integral
-  Double_t Dist              ( Double_t Z, Double_t radius ) ;  
-  Double_t HitDensity        ( Double_t radius )   ;
-  Double_t UpcHitDensity     ( Double_t radius )   ;
-  Double_t IntegratedHitDensity  ( Double_t multiplicity, Double_t radius )   ;
+  Double_t Dist              ( Double_t Z, Double_t radius ) const ;  
+  Double_t HitDensity        ( Double_t radius ) const  ;
+  Double_t ComputeHitDensity ( Double_t radius ) const  ;
+  void     UpdateHitDensity  ()  ;
+  void     UpdateSolver      ()  ;
+  std::vector<SolverLayerK> BuildSolverLayers() const;
+  Double_t UpcHitDensity     ( Double_t radius ) const  ;
+  Double_t IntegratedHitDensity  ( Double_t multiplicity, Double_t radius ) const  ;
   Double_t OneEventHitDensity    ( Double_t multiplicity, Double_t radius ) const   ;
   
   TGraph* GetGraphMomentumResolution(Int_t color, Int_t linewidth=1);
@@ -226,12 +245,11 @@ class DetectorK : public TNamed {
   // method to extend AliExternalTrackParam functionality
   static Bool_t GetXatLabR(AliExternalTrackParam* tr,Double_t r,Double_t &x, Double_t bz, Int_t dir=0);
   static Bool_t PropagateToR(AliExternalTrackParam* trc, double r, double b, int dir=0, double maxStep=2.0);
-  Double_t* PrepareEffFakeKombinations(TMatrixD *probKomb, TMatrixD *probLay, int nl, double* prob=0);
+  static Bool_t PropagateHelixTo(AliExternalTrackParam* trc, double x, double b);
+  Double_t* PrepareEffFakeKombinations(TMatrixD *probLay, int nl, double* prob=0) const;
 
   Bool_t IsITSLayer(const TString& lname);
 
-  Double_t GetGoodHitProb(Int_t i) { return fGoodHitProb[i]; };
-  
   static Bool_t verboseR;
  protected:
  
@@ -268,7 +286,6 @@ class DetectorK : public TNamed {
   Double_t fDetPointZRes[kMaxNumberOfDetectors][kNptBins];   // array of z resolution per layer
   Double_t fEfficiency[kNptBins];                            // efficiency 
   Double_t fFake[kNptBins];                                  // fake prob
-  Double_t fGoodHitProb[kMaxNumberOfDetectors];              // array of good hit probability per layer
   
   Int_t kDetLayer;                              // layer for which a few more details are extracted
   Double_t fResolutionRPhiLay[kNptBins];                        // array of rphi resolution
@@ -276,11 +293,15 @@ class DetectorK : public TNamed {
   Double_t fEfficProlongLay[kNptBins];                           // array of z resolution
 
   Double_t fMinRadTrack;
+  Double_t fProductionRadius; // layers inside this radius are not crossed by the track
+
+  std::map<Double_t, Double_t> fHitDensity; //! hit density at the layer radii for the current multiplicity
+  std::vector<SolverLayerK> fSolverLayers;  //! flat layer array for SolveTrack
 
   static const Double_t kPtMinFix;
   static const Double_t kPtMaxFix;
 
-  ClassDef(DetectorK,1);
+  ClassDef(DetectorK,3);
 };
 
 #endif
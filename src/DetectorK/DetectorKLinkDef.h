@@ -0,0 +1,15 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifdef __CLING__
+
+#pragma link off all globals;
+#pragma link off all classes;
+#pragma link off all functions;
+
+#pragma link C++ class HistoManager+;
+#pragma link C++ class TrackSol+;
+#pragma link C++ class CylLayerK+;
+#pragma link C++ class DetectorK+;
+
+#endif
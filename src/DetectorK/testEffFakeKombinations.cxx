@@ -0,0 +1,72 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/// checks DetectorK::PrepareEffFakeKombinations, built layer by layer on the
+/// distributions of the number of correct and fake hits, against the walk
+/// over the 3^nLayer (null, fake, correct) outcomes it replaces
+
+#include <cmath>
+#include <cstdio>
+
+#include "TMatrixD.h"
+#include "TRandom3.h"
+#include "DetectorK.h"
+
+void
+enumerate(const TMatrixD &probLay, int nLayer, int atLeastCorr, int atLeastHits, int atLeastFake, double *probs)
+{
+  // the combinatorics of the original DetectorK, outcome k of layer l is digit l of num in base 3
+  int komb = 1;
+  for (int l = 0; l < nLayer; ++l) komb *= 3;
+  const int kAtLeastCorr = atLeastCorr == -1 ? nLayer : atLeastCorr;
+  probs[0] = probs[1] = 0.;
+  for (int num = 0; num < komb; ++num) {
+    int flCorr = 0, flFake = 0;
+    double prob = 1.;
+    for (int l = 0, digits = num; l < nLayer; ++l, digits /= 3) {
+      const int k = digits % 3;
+      if (k == 1) flFake++;
+      else if (k == 2) flCorr++;
+      prob *= probLay(k, l);
+    }
+    if (flCorr + flFake < atLeastHits) continue;
+    if (flCorr >= kAtLeastCorr && flFake == 0) probs[0] += prob;
+    if (flFake >= atLeastFake) probs[1] += prob;
+  }
+}
+
+int main()
+{
+  TRandom3 rnd(12345);
+  DetectorK det;
+  int nChecks = 0, nFailed = 0;
+  for (int nLayer = 1; nLayer <= 8; ++nLayer) {
+    TMatrixD probLay(3, nLayer);
+    for (int l = 0; l < nLayer; ++l) {
+      // null, fake and correct, with the extremes of dead and perfect layers
+      double p[3] = {rnd.Rndm(), rnd.Rndm(), rnd.Rndm()};
+      if (l == 1) p[0] = p[1] = 0.;
+      if (l == 2) p[1] = p[2] = 0.;
+      const double sum = p[0] + p[1] + p[2];
+      for (int k = 0; k < 3; ++k) probLay(k, l) = p[k] / sum;
+    }
+    for (int atLeastCorr = -1; atLeastCorr <= nLayer; ++atLeastCorr)
+      for (int atLeastHits = -1; atLeastHits <= nLayer; ++atLeastHits)
+        for (int atLeastFake = -1; atLeastFake <= nLayer; ++atLeastFake) {
+          det.SetAtLeastCorr(atLeastCorr);
+          det.SetAtLeastHits(atLeastHits);
+          det.SetAtLeastFake(atLeastFake);
+          double probs[2], expected[2];
+          det.PrepareEffFakeKombinations(&probLay, nLayer, probs);
+          enumerate(probLay, nLayer, atLeastCorr, atLeastHits, atLeastFake, expected);
+          nChecks++;
+          if (std::abs(probs[0] - expected[0]) > 1.e-12 || std::abs(probs[1] - expected[1]) > 1.e-12) {
+            printf("nLayer = %d, atLeastCorr = %d, atLeastHits = %d, atLeastFake = %d: eff %.15f / %.15f, fake %.15f / %.15f \n",
+                   nLayer, atLeastCorr, atLeastHits, atLeastFake, probs[0], expected[0], probs[1], expected[1]);
+            nFailed++;
+          }
+        }
+  }
+  printf("%d of %d efficiency and fake probabilities differ from the enumeration \n", nFailed, nChecks);
+  return nFailed > 0;
+}
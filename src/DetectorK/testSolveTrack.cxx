@@ -0,0 +1,443 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/// checks the covariances of DetectorK::SolveTrack and DetectorK::SolveTracks, on the flat
+/// layer array and with packs of tracks, against the solver they replace on a fixed set of
+/// (nch, eta, pt) bins of the default lut-writer geometry
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#include "TMath.h"
+#include "TClonesArray.h"
+#include "AliExternalTrackParam.h"
+#include "DetectorK.h"
+
+#define xrhosteps     100         // steps for dEdx correction, as in DetectorK.cxx
+
+class BaselineDetectorK : public DetectorK
+{
+ public:
+  Bool_t SolveTrackBaseline(TrackSol& ts) const;
+};
+
+Bool_t BaselineDetectorK::SolveTrackBaseline(TrackSol& ts) const {
+  //
+  // DetectorK::SolveTrack before the flat layer array and the packs of tracks, unchanged
+  //
+  double ptTr = ts.fPt;
+  double etaTr = ts.fEta;
+  double mass = ts.fMass;
+  double charge = ts.fCharge;
+
+  // reset good hit probability
+  Double_t *goodHitProb = ts.fGoodHitProb;
+  for (int i = 0; i < TrackSol::kMaxLayers; ++i)
+    goodHitProb[i] = -1.;
+  goodHitProb[0] = 1.; // we use layer zero to accumulate
+    
+  if (ptTr<0) { 
+    printf("Input track is not initialized");
+    return kFALSE;
+  }
+  
+  const float kTrackingMargin = 0.1;
+
+  AliExternalTrackParam probTr;   // track to propagate
+  // the MS log term is a global switch of AliExternalTrackParam, only write it when it changes
+  if (!AliExternalTrackParam::GetUseLogTermMS()) AliExternalTrackParam::SetUseLogTermMS(kTRUE);
+  //
+  TClonesArray &saveParInward    = ts.fTrackInw;
+  TClonesArray &saveParOutwardB  = ts.fTrackOutB;
+  TClonesArray &saveParOutwardA  = ts.fTrackOutA;
+  TClonesArray &saveParComb      = ts.fTrackCmb;
+
+  Double_t pt,lambda;
+  //
+  CylLayerK *last = (CylLayerK*) fLayers.At((fLayers.GetEntries()-1));
+  double maxR = last->radius+kTrackingMargin*2;
+  double minRad = (fMinRadTrack>0&&fMinRadTrack<maxR) ? fMinRadTrack : maxR;
+  //
+  if (last->radius > minRad) {
+    last = 0;
+    for (Int_t i=0; i<fLayers.GetEntries();i++) {
+      CylLayerK *l = (CylLayerK*) fLayers.At(i);
+      if (/*!(l->isDead) && */(l->radius<minRad)) last = l;
+    }
+    if (!last) {
+      printf("No layer with radius < %f is found\n",minRad);
+      return kFALSE;
+    }
+  }
+  //  
+  lambda = TMath::Pi()/2.0 - 2.0*TMath::ATan(TMath::Exp(-etaTr));
+  //  
+  // Assume track started at (0,0,0) and shoots out on the X axis, and B field is on the Z axis
+  // These are the EndPoint values for y, z, a, b, and d
+  double bGauss = fBField*10;               // field in kgauss
+  pt  =  ptTr;
+  enum {kY,kZ,kSnp,kTgl,kPtI};              // track parameter aliases
+  enum {kY2,kYZ,kZ2,kYSnp,kZSnp,kSnp2,kYTgl,kZTgl,kSnpTgl,kTgl2,kYPtI,kZPtI,kSnpPtI,kTglPtI,kPtI2}; // cov.matrix aliases
+  //
+  probTr.Reset();
+  double *trPars = (double*)probTr.GetParameter();
+  double *trCov  = (double*)probTr.GetCovariance();
+  trPars[kY] = 0;                         // start from Y = 0
+  trPars[kZ] = 0;                         //            Z = 0 
+  trPars[kSnp] = 0;                       //            track along X axis at the vertex
+  trPars[kTgl] = TMath::Tan(lambda);      //            dip
+  trPars[kPtI] = charge/pt;               //            q/pt      
+  //
+  // put tiny errors to propagate to the outer radius
+  trCov[kY2] = trCov[kZ2] = trCov[kSnp2] = trCov[kTgl2] = trCov[kPtI2] = 1e-9;
+  //
+  // find max layer this track can reach
+  double rmx = (TMath::Abs(fBField)>1e-5) ?  pt*100./(0.3*TMath::Abs(fBField)) : 9999;
+  //  if (2*rmx-5. < minRad && minRad>0) {
+  if ( minRad/(2.*rmx)>fMaxSnp-0.01 && minRad>0) {
+    //    printf("Track of pt=%.3f cannot be tracked to min. r=%f\n",pt,minRad);
+    return kFALSE;
+  }
+  Int_t lastActiveLayer = -1, lastReachedLayer = -1;
+  for (Int_t j=fLayers.GetEntries(); j--;) { 
+    CylLayerK *l = (CylLayerK*) fLayers.At(j);
+    if (/*!(l->isDead) && */(l->radius <= 2*(rmx-5))) {lastActiveLayer = j; last = l; break;}
+  }
+  if (lastActiveLayer<0) {
+    printf("No active layer with radius < %f is found, pt = %f\n",rmx, pt);
+    return kFALSE;
+  }
+  //
+  for (int il=1;il<=lastActiveLayer;il++) {
+    CylLayerK *lr = (CylLayerK*) fLayers.At(il);
+    Bool_t isInside = lr->radius < fProductionRadius; // not crossed by a secondary track
+    AliExternalTrackParam probTrLast(probTr);
+    bool ok = PropagateToR(&probTrLast,lr->radius,bGauss,1);
+    if (ok && !isInside) ok = probTrLast.CorrectForMeanMaterial(lr->radL, 0, mass , kTRUE);
+    if (ok && !isInside && lr->xrho>0) {
+      for (int ise=xrhosteps;ise--;) {
+	ok = probTrLast.CorrectForMeanMaterial(0, -lr->xrho/xrhosteps, mass , kTRUE);
+	if (!ok) break;
+      }
+    }
+    if (ok && lr->radius>1e-3 && !lr->isDead) {
+      ok = probTrLast.Rotate(probTrLast.PhiPos()) && TMath::Abs( probTrLast.GetSnp() )<fMaxSnp;
+    }
+    // was there a problem on this layer?
+    if (!ok) { // may fail to reach target layer due to the eloss
+      double rad2 = probTr.GetX()*probTr.GetX() + probTr.GetY()*probTr.GetY();
+      if (rad2 - minRad*minRad < kTrackingMargin*kTrackingMargin) { // check previously reached layer
+	return kFALSE; // did not reach min requested layer
+      }
+      else {
+	break;
+      }
+    }
+    probTr = probTrLast;
+    lastReachedLayer = il;
+  }
+  // do tiny overshoot for the safety of the back-propagation
+  if (!PropagateToR(&probTr,probTr.GetX() + kTrackingMargin,bGauss,1)) return kFALSE;
+  if (!probTr.Rotate(probTr.PhiPos())) return kFALSE;
+  //
+  const double kLargeErr2Coord = 5*5;
+  const double kLargeErr2Dir = 0.7*0.7;
+  const double kLargeErr2PtI = 30.5*30.5;
+  for (int ic=15;ic--;) trCov[ic] = 0.;
+  trCov[kY2]   = trCov[kZ2]   = kLargeErr2Coord; 
+  trCov[kSnp2] = trCov[kTgl2] = kLargeErr2Dir;
+  trCov[kPtI2] = kLargeErr2PtI*trPars[kPtI]*trPars[kPtI];
+  probTr.CheckCovariance();
+  //
+  // Back-propagate the covariance matrix along the track.   
+  CylLayerK *layer = 0;
+  //
+  for (Int_t j=lastReachedLayer+1; j--;) {  // Layer loop
+    
+    layer = (CylLayerK*)fLayers.At(j);
+    
+    if (layer->radius>fMaxSeedRadius) continue; // no seeding beyond this radius 
+    
+    TString name(layer->GetName());
+    Bool_t isVertex = name.Contains("vertex");
+    Bool_t isTOF = name.Contains("tof");
+    Bool_t isInside = layer->radius < fProductionRadius;
+    //
+    if (!PropagateToR(&probTr,layer->radius,bGauss,-1)) return kFALSE; //exit(1);
+    if (!isVertex) {
+      double pos[3];
+      probTr.GetXYZ(pos);  // lab position
+      double phi = TMath::ATan2(pos[1],pos[0]);
+      if ( TMath::Abs(TMath::Abs(phi)-TMath::Pi()/2)<1e-3) phi = 0;//TMath::Sign(TMath::Pi()/2 - 1e-3,phi);
+      if (!probTr.Rotate(phi)) {
+	printf("Failed to rotate to the frame (phi:%+.3f)of layer at %.2f at XYZ: %+.3f %+.3f %+.3f (pt=%+.3f)\n",
+	       phi,layer->radius,pos[0],pos[1],pos[2],pt);	
+	probTr.Print();
+	return kFALSE; // exit(1);
+      }
+    }
+    // save inward parameters at this layer: before the update!
+    new( saveParInward[j] ) AliExternalTrackParam(probTr);
+    if (verboseR) {
+      printf("SaveInw %d (%f)  ",j,layer->radius); probTr.Print();
+    }    
+    //
+    if (!isVertex && !isTOF && !layer->isDead && !isInside) {
+      //
+      // create fake measurement with the errors assigned to the layer
+      // account for the measurement there 
+      double meas[2] = {probTr.GetY(),probTr.GetZ()};
+      double measErr2[3] = {layer->phiRes*layer->phiRes,0,layer->zRes*layer->zRes};
+      //
+      if (!probTr.Update(meas,measErr2)) {
+	printf("Failed to update the track by measurement {%.3f,%3f} err {%.3e %.3e %.3e}\n",
+	       meas[0],meas[1], measErr2[0],measErr2[1],measErr2[2]);
+	probTr.Print();
+	return kFALSE; // exit(1);
+      }
+    }
+    // correct for materials of this layer
+    // note: if apart from MS we want also e.loss correction, the density*length should be provided as 2nd param
+    if (!isInside && layer->radL>0 && !probTr.CorrectForMeanMaterial(layer->radL, 0, mass , kTRUE)) {
+      printf("Failed to apply material correction, X/X0=%.4f\n",layer->radL);
+      probTr.Print();
+      return kFALSE; // exit(1);
+    }
+    if (!isInside && layer->xrho>0) { // correct in small steps
+      for (int ise=xrhosteps;ise--;) {
+	if (!probTr.CorrectForMeanMaterial(0, layer->xrho/xrhosteps, mass , kTRUE)) {
+	  printf("Failed to apply material correction, xrho=%.4f\n",layer->xrho);
+	  probTr.Print();
+	  return kFALSE; // exit(1);
+	}
+      }
+    }
+  }
+  //  
+  // BACKWORD TRACKING +++++++++++++++++
+  // number of layers is quite low ... efficiency calculation was probably nonsense 
+  // Tracking outward (backword) to get reliable efficiencies from "smoothed estimates"
+  
+  // For below, see paper, NIM A262 (1987) p.444, eqs.12.
+  // Equivalently, one can simply combine the forward and backward estimates. Assuming
+  // pf,Cf and pb,Cb as extrapolated position estimates and errors from fwd and bwd passes one can
+  // use a weighted estimate Cw = (Cf^-1 + Cb^-1)^-1,  pw = Cw (pf Cf^-1 + pb Cb^-1).
+  // Surely, for the most extreme point, where one error matrices is infinite, this does not change anything.
+  
+  Bool_t doLikeAliRoot = 0; // don't do the "combined info" but do like in Aliroot
+  
+  // RESET Covariance Matrix ( to 10 x the estimate -> as it is done in AliExternalTrackParam)
+  //	mIstar.UnitMatrix(); // start with unity
+  if (doLikeAliRoot) {
+    probTr.ResetCovariance(100);
+  } else {
+    // cannot do complete reset, set to very large errors
+    for (int ic=15;ic--;) trCov[ic] = 0.;
+    trCov[kY2]   = trCov[kZ2]   = kLargeErr2Coord; 
+    trCov[kSnp2] = trCov[kTgl2] = kLargeErr2Dir;
+    trCov[kPtI2] = kLargeErr2PtI*trPars[kPtI]*trPars[kPtI];
+    probTr.CheckCovariance();
+  }    
+  // find first "active layer" - start tracking at the first active layer      
+  Int_t firstActiveLayer = 0;
+  for (Int_t j=0; j<=lastActiveLayer; j++) { 
+    layer = (CylLayerK*)fLayers.At(j);
+    if (!(layer->isDead)) { // is alive
+      firstActiveLayer = j;
+      break;
+    }
+  }
+  //probTr.Rotate(0);
+  for (Int_t j=0; j<=lastReachedLayer; j++) {  // Layer loop
+    //
+    layer = (CylLayerK*)fLayers.At(j);
+    TString name(layer->GetName());
+    Bool_t isVertex = name.Contains("vertex");
+    Bool_t isTOF = name.Contains("tof");
+    Bool_t isInside = layer->radius < fProductionRadius;
+    if (!PropagateToR(&probTr, layer->radius,bGauss,1)) return kFALSE;//exit(1);
+    //
+    if (!isVertex) {
+      // rotate to frame with X axis normal to the surface
+      double pos[3];
+      probTr.GetXYZ(pos);  // lab position
+      double phi = TMath::ATan2(pos[1],pos[0]);
+      if ( TMath::Abs(TMath::Abs(phi)-TMath::Pi()/2)<1e-3) phi = 0;//TMath::Sign(TMath::Pi()/2 - 1e-3,phi);
+      if (!probTr.Rotate(phi)) {
+	printf("Failed to rotate to the frame (phi:%+.3f)of layer at %.2f at XYZ: %+.3f %+.3f %+.3f (pt=%+.3f)\n",
+	       phi,layer->radius,pos[0],pos[1],pos[2],pt);	      
+	probTr.Print();
+	return kFALSE; // exit(1);
+      }
+    }
+    //
+    // save outward parameters at this layer: before the update
+    new( saveParOutwardB[j] ) AliExternalTrackParam(probTr);
+    //
+    // combined in-out prediction
+    new( saveParComb[j]  ) AliExternalTrackParam(*(AliExternalTrackParam*)saveParInward[j]);
+    double *covInw = (double*) ((AliExternalTrackParam*)saveParInward[j])->GetCovariance();
+    double *covOut = (double*) probTr.GetCovariance();
+    double *covCmb = (double*) ((AliExternalTrackParam*)saveParComb[j])->GetCovariance();
+    covCmb[0] = covInw[0]*covOut[0]/(covInw[0]+covOut[0]);
+    covCmb[2] = covInw[2]*covOut[2]/(covInw[2]+covOut[2]);
+    covCmb[1] = 0;
+    // create fake measurement with the errors assigned to the layer
+    // account for the measurement there
+    if (!isVertex && !isTOF && !layer->isDead && !isInside) {
+      double meas[2] = {probTr.GetY(),probTr.GetZ()};
+      double measErr2[3] = {layer->phiRes*layer->phiRes,0,layer->zRes*layer->zRes};
+      //
+      if (!probTr.Update(meas,measErr2)) {
+	printf("Failed to update the track by measurement {%.3f,%3f} err {%.3e %.3e %.3e}\n",
+	       meas[0],meas[1], measErr2[0],measErr2[1],measErr2[2]);
+	probTr.Print();
+	return kFALSE; // exit(1);
+      }
+    }
+    // note: if apart from MS we want also e.loss correction, the density*length should be provided as 2nd param
+    if (!isInside && layer->radL>0 && !probTr.CorrectForMeanMaterial(layer->radL, 0, mass , kTRUE)) {
+      printf("Failed to apply material correction, X/X0=%.4f\n",layer->radL);
+      probTr.Print();
+      return kFALSE; // exit(1);
+    }
+    if (!isInside && layer->xrho>0) { // correct in small steps
+      for (int ise=xrhosteps;ise--;) {
+	if (!probTr.CorrectForMeanMaterial(0, -layer->xrho/xrhosteps, mass , kTRUE)) {
+	  printf("Failed to apply material correction, xrho=%.4f\n",-layer->xrho);
+	  probTr.Print();
+	  return kFALSE; // exit(1);
+	}
+      }
+    }
+    // save outward parameters at this layer: after the update
+    new( saveParOutwardA[j] ) AliExternalTrackParam(probTr);
+    //
+    // good hit probability calculation
+    if (!isVertex && !layer->isDead && !isInside) {
+      AliExternalTrackParam* trCmb = (AliExternalTrackParam*)ts.fTrackCmb[j];
+      double sigYCmb = TMath::Sqrt(trCmb->GetSigmaY2()+layer->phiRes*layer->phiRes);
+      double sigZCmb = TMath::Sqrt(trCmb->GetSigmaZ2()+layer->zRes*layer->zRes);
+      goodHitProb[j] = ProbGoodChiSqHit(layer->radius * 100., sigYCmb * 100., sigZCmb * 100.);
+      if (!isTOF)
+        goodHitProb[0]  *= goodHitProb[j];
+    }
+  }
+  //  
+  return kTRUE;
+}
+
+void
+fatInit(DetectorK &fat)
+{
+  // the geometry of lutWrite.default.cc, with a TOF layer at the end
+  fat.SetBField(0.5);
+  Double_t x0IB     = 0.0005;
+  Double_t x0OB     = 0.005;
+  Double_t xrhoIB     = 1.1646e-02; // 50 mum Si
+  Double_t xrhoOB     = 1.1646e-01; // 500 mum Si
+  Double_t resRPhiIB     = 0.0001;
+  Double_t resZIB        = 0.0001;
+  Double_t resRPhiOB     = 0.0005;
+  Double_t resZOB        = 0.0005;
+  Double_t eff           = 0.98;
+  fat.AddLayer((char*)"vertex", 0.0,      0,        0); // dummy vertex for matrix calculation
+  fat.AddLayer((char*)"bpipe",  1.6, 0.0014, 9.24e-02); // 500 mum Be | nominal R5?
+  fat.AddLayer((char*)"ddd1",   1.8,  x0IB, xrhoIB, resRPhiIB, resZIB, eff);
+  fat.AddLayer((char*)"ddd2",   2.8,  x0IB, xrhoIB, resRPhiIB, resZIB, eff);
+  fat.AddLayer((char*)"ddd3",   3.8,  x0IB, xrhoIB, resRPhiIB, resZIB, eff);
+  fat.AddLayer((char*)"ddd3a",  8.0,  x0OB, xrhoOB, resRPhiOB, resZOB, eff);
+  fat.AddLayer((char*)"ddd4",   20.,  x0OB, xrhoOB, resRPhiOB, resZOB, eff);
+  fat.AddLayer((char*)"ddd5",   25.,  x0OB, xrhoOB, resRPhiOB, resZOB, eff);
+  fat.AddLayer((char*)"ddd7",   40.,  x0OB, xrhoOB, resRPhiOB, resZOB, eff);
+  fat.AddLayer((char*)"ddd8",   55.,  x0OB, xrhoOB, resRPhiOB, resZOB, eff);
+  fat.AddLayer((char*)"dddY",   80.,  x0OB, xrhoOB, resRPhiOB, resZOB, eff);
+  fat.AddLayer((char*)"dddX",  100.,  x0OB, xrhoOB, resRPhiOB, resZOB, eff);
+  fat.AddLayer((char*)"tof",   110.,  0.02,      0., 0.0030, 0.0030, eff);
+  fat.SetAtLeastHits(4);
+  fat.SetAtLeastCorr(4);
+  fat.SetAtLeastFake(0);
+  fat.SetMinRadTrack(100.);
+}
+
+bool
+differ(double a, double b)
+{
+  return std::abs(a - b) > 1.e-12 * std::max(1., std::max(std::abs(a), std::abs(b)));
+}
+
+int
+compare(const TrackSol &ts, const TrackSol &ref, int nLayers)
+{
+  // parameters and covariances of every saved state, and the good hit probabilities
+  int nDiffer = 0;
+  const TClonesArray *states[4] = {&ts.fTrackInw, &ts.fTrackOutB, &ts.fTrackOutA, &ts.fTrackCmb};
+  const TClonesArray *refStates[4] = {&ref.fTrackInw, &ref.fTrackOutB, &ref.fTrackOutA, &ref.fTrackCmb};
+  for (int is = 0; is < 4; ++is)
+    for (int j = 0; j < nLayers; ++j) {
+      auto tr = (const AliExternalTrackParam *)states[is]->At(j);
+      auto trRef = (const AliExternalTrackParam *)refStates[is]->At(j);
+      if (!tr || !trRef) {
+        if (tr != trRef) nDiffer++;
+        continue;
+      }
+      for (int i = 0; i < 5; ++i)
+        if (differ(tr->GetParameter()[i], trRef->GetParameter()[i])) nDiffer++;
+      for (int i = 0; i < 15; ++i)
+        if (differ(tr->GetCovariance()[i], trRef->GetCovariance()[i])) nDiffer++;
+    }
+  for (int j = 0; j < nLayers; ++j)
+    if (differ(ts.fGoodHitProb[j], ref.fGoodHitProb[j])) nDiffer++;
+  return nDiffer;
+}
+
+int main()
+{
+  const int nchs[] = {1, 400, 2000};
+  const double etas[] = {0., 0.5, 1.0, 1.5};
+  const double pts[] = {0.05, 0.1, 0.2, 0.5, 1., 2., 5., 20.};
+  const int npt = sizeof(pts) / sizeof(double);
+  const double mass = 0.13957;
+  BaselineDetectorK fat;
+  fatInit(fat);
+  const int nLayers = (int)fat.GetNumberOfLayers();
+  int nChecks = 0, nFailed = 0, nSolved = 0;
+  for (auto nch : nchs) {
+    fat.SetdNdEtaCent(nch);
+    for (auto eta : etas)
+      for (int q = -1; q <= 1; q += 2) {
+        TrackSol *refs[npt], *singles[npt], *pack[npt];
+        Bool_t refSolved[npt], singleSolved[npt], packSolved[npt];
+        for (int ipt = 0; ipt < npt; ++ipt) {
+          refs[ipt] = new TrackSol(nLayers, pts[ipt], eta, q, mass);
+          singles[ipt] = new TrackSol(nLayers, pts[ipt], eta, q, mass);
+          pack[ipt] = new TrackSol(nLayers, pts[ipt], eta, q, mass);
+          refSolved[ipt] = fat.SolveTrackBaseline(*refs[ipt]);
+          singleSolved[ipt] = fat.SolveTrack(*singles[ipt]);
+        }
+        fat.SolveTracks(pack, npt, packSolved);
+        for (int ipt = 0; ipt < npt; ++ipt) {
+          nChecks++;
+          int nDiffer = 0;
+          if (singleSolved[ipt] != refSolved[ipt] || packSolved[ipt] != refSolved[ipt])
+            nDiffer++;
+          else if (refSolved[ipt]) {
+            nSolved++;
+            nDiffer += compare(*singles[ipt], *refs[ipt], nLayers);
+            nDiffer += compare(*pack[ipt], *refs[ipt], nLayers);
+          }
+          if (nDiffer > 0) {
+            printf("nch = %d, eta = %.2f, pt = %.2f, q = %d: %d values differ from the baseline solver (solved %d / %d / %d) \n",
+                   nch, eta, pts[ipt], q, nDiffer, refSolved[ipt], singleSolved[ipt], packSolved[ipt]);
+            nFailed++;
+          }
+          delete refs[ipt];
+          delete singles[ipt];
+          delete pack[ipt];
+        }
+      }
+  }
+  printf("%d of %d tracks (%d solved) differ from the baseline solver \n", nFailed, nChecks, nSolved);
+  return nFailed > 0 || nSolved == 0;
+}
@@ -0,0 +1,140 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "FastVertexer.hh"
+#include <algorithm>
+#include <cmath>
+
+namespace o2
+{
+namespace delphes
+{
+
+/*****************************************************************/
+
+void
+FastVertexer::addTrack(const O2Track &o2track)
+{
+  float snp = o2track.getSnp();
+  float csp = std::sqrt((1.f - snp) * (1.f + snp));
+  if (csp < 1.e-3) return;
+  double syy = o2track.getSigmaY2(), syz = o2track.getSigmaZY(), szz = o2track.getSigmaZ2();
+  double det = syy * szz - syz * syz;
+  if (!(det > 0.)) return;
+  Line line;
+  line.cosa = std::cos(o2track.getAlpha());
+  line.sina = std::sin(o2track.getAlpha());
+  line.ty = snp / csp;
+  line.tz = o2track.getTgl() / csp;
+  line.y0 = o2track.getY() - line.ty * o2track.getX();
+  line.z0 = o2track.getZ() - line.tz * o2track.getX();
+  line.wyy = szz / det;
+  line.wyz = -syz / det;
+  line.wzz = syy / det;
+  mTracks.push_back(line);
+}
+
+/*****************************************************************/
+
+bool
+FastVertexer::process(Result &result) const
+{
+  // the track residuals are linear in the vertex position v:
+  //   ry = y0 + Jy.v, rz = z0 + Jz.v
+  // each iteration solves the normal equations with the Tukey weights of the previous vertex
+  const int nTracks = mTracks.size();
+  if (nTracks < mMinTracks) return false;
+
+  const double tukey2 = mTukey * mTukey;
+  double v[3] = {0., 0., 0.}, cov[6];
+  // the outliers pull the first vertices away, the Tukey cut starts wide and shrinks with the
+  // weighted chi2 per degree of freedom of the previous iteration, down to mTukey sigmas
+  std::vector<double> chi2(nTracks), weight(nTracks, 1.);
+  double scale2 = 1.;
+  for (int iter = 0; iter < mMaxIterations; ++iter) {
+    if (iter > 0) {
+      double sumw = 0., sumwchi2 = 0.;
+      for (int i = 0; i < nTracks; ++i) {
+        auto &l = mTracks[i];
+        double ry = l.y0 + (l.ty * l.cosa + l.sina) * v[0] + (l.ty * l.sina - l.cosa) * v[1];
+        double rz = l.z0 + l.tz * l.cosa * v[0] + l.tz * l.sina * v[1] - v[2];
+        chi2[i] = l.wyy * ry * ry + 2. * l.wyz * ry * rz + l.wzz * rz * rz;
+        sumw += weight[i];
+        sumwchi2 += weight[i] * chi2[i];
+      }
+      scale2 = sumw > 0. ? std::max(1., 0.5 * sumwchi2 / sumw) : 1.;
+      for (int i = 0; i < nTracks; ++i) {
+        double x = chi2[i] / (tukey2 * scale2);
+        weight[i] = x < 1. ? (1. - x) * (1. - x) : 0.;
+      }
+    }
+
+    double a[6] = {0.}, b[3] = {0.};
+    int nUsed = 0;
+    for (int i = 0; i < nTracks; ++i) {
+      auto &l = mTracks[i];
+      double w = weight[i];
+      if (!(w > 0.)) continue;
+      nUsed++;
+      double jy[3] = {l.ty * l.cosa + l.sina, l.ty * l.sina - l.cosa, 0.};
+      double jz[3] = {l.tz * l.cosa, l.tz * l.sina, -1.};
+      // W J rows, weighted
+      double wy[3], wz[3];
+      for (int k = 0; k < 3; ++k) {
+        wy[k] = w * (l.wyy * jy[k] + l.wyz * jz[k]);
+        wz[k] = w * (l.wyz * jy[k] + l.wzz * jz[k]);
+      }
+      for (int k = 0, kl = 0; k < 3; ++k) {
+        for (int j = k; j < 3; ++j, ++kl)
+          a[kl] += jy[k] * wy[j] + jz[k] * wz[j];
+        b[k] -= wy[k] * l.y0 + wz[k] * l.z0;
+      }
+    }
+    if (nUsed < mMinTracks) return false;
+
+    // symmetric 3x3 inverse, a = {00, 01, 02, 11, 12, 22}
+    double c00 = a[3] * a[5] - a[4] * a[4];
+    double c01 = a[2] * a[4] - a[1] * a[5];
+    double c02 = a[1] * a[4] - a[2] * a[3];
+    double det = a[0] * c00 + a[1] * c01 + a[2] * c02;
+    if (!(det > 0.)) return false;
+    cov[0] = c00 / det;
+    cov[1] = c01 / det;
+    cov[2] = c02 / det;
+    cov[3] = (a[0] * a[5] - a[2] * a[2]) / det;
+    cov[4] = (a[1] * a[2] - a[0] * a[4]) / det;
+    cov[5] = (a[0] * a[3] - a[1] * a[1]) / det;
+
+    double vnew[3] = {cov[0] * b[0] + cov[1] * b[1] + cov[2] * b[2],
+                      cov[1] * b[0] + cov[3] * b[1] + cov[4] * b[2],
+                      cov[2] * b[0] + cov[4] * b[1] + cov[5] * b[2]};
+    double shift2 = 0.;
+    for (int k = 0; k < 3; ++k) {
+      shift2 += (vnew[k] - v[k]) * (vnew[k] - v[k]);
+      v[k] = vnew[k];
+    }
+    if (iter > 0 && scale2 == 1. && shift2 < mTolerance * mTolerance) break;
+  }
+
+  // quality at the final vertex
+  result.chi2 = 0.;
+  result.nContributors = 0;
+  for (auto &l : mTracks) {
+    double ry = l.y0 + (l.ty * l.cosa + l.sina) * v[0] + (l.ty * l.sina - l.cosa) * v[1];
+    double rz = l.z0 + l.tz * l.cosa * v[0] + l.tz * l.sina * v[1] - v[2];
+    double chi2 = l.wyy * ry * ry + 2. * l.wyz * ry * rz + l.wzz * rz * rz;
+    if (chi2 >= tukey2) continue;
+    result.chi2 += chi2;
+    result.nContributors++;
+  }
+  if (result.nContributors < mMinTracks) return false;
+  result.vertex = {v[0], v[1], v[2]};
+  for (int k = 0; k < 6; ++k)
+    result.cov[k] = cov[k];
+  return true;
+}
+
+/*****************************************************************/
+
+} /** namespace delphes **/
+} /** namespace o2 **/
@@ -0,0 +1,63 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _DelphesO2_FastVertexer_h_
+#define _DelphesO2_FastVertexer_h_
+
+#include "VertexFitter.hh"
+#include <array>
+#include <vector>
+
+namespace o2
+{
+namespace delphes
+{
+
+/// analytic primary vertex of one collision: iterative weighted least squares
+/// on the tracks at their DCA to the beam line, as given by the smearer,
+/// with Tukey down-weighting of the outliers. Needs no geometry nor field map
+
+class FastVertexer {
+
+public:
+  FastVertexer() = default;
+  ~FastVertexer() = default;
+
+  struct Result {
+    Vertex vertex;              // [cm]
+    std::array<float, 6> cov;   // xx, xy, xz, yy, yz, zz [cm2]
+    float chi2;
+    int nContributors;
+  };
+
+  void setMaxIterations(int val) { mMaxIterations = val; };
+  void setTukey(float val) { mTukey = val; };
+  void setTolerance(float val) { mTolerance = val; };
+  void setMinTracks(int val) { mMinTracks = val; };
+
+  void clear() { mTracks.clear(); };
+  void addTrack(const O2Track &o2track);
+  bool process(Result &result) const;
+
+protected:
+
+  // straight line around the track reference point, in the track frame
+  struct Line {
+    float cosa, sina;   // track frame rotation
+    float y0, z0;       // y and z at the track frame origin
+    float ty, tz;       // dy/dx and dz/dx
+    float wyy, wyz, wzz; // inverse of the y-z covariance
+  };
+
+  int mMaxIterations = 10;
+  float mTukey = 4.;      // tracks beyond mTukey sigmas do not contribute
+  float mTolerance = 1.e-4; // [cm]
+  int mMinTracks = 2;
+
+  std::vector<Line> mTracks;
+};
+
+} /** namespace delphes **/
+} /** namespace o2 **/
+
+#endif /** _DelphesO2_FastVertexer_h_ **/
@@ -0,0 +1,150 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "ThreeProngFinder.hh"
+#include "TrackUtils.hh"
+#include <algorithm>
+#include <cmath>
+
+namespace o2
+{
+namespace delphes
+{
+
+namespace
+{
+constexpr float kMassPion = TrackUtils::kMassPion;
+constexpr float kMassKaon = TrackUtils::kMassKaon;
+constexpr float kMassProton = TrackUtils::kMassProton;
+constexpr float kMassDplus = 1.86966;
+constexpr float kMassLc = 2.28646;
+constexpr float kMassDs = 1.96835;
+} // namespace
+
+/*****************************************************************/
+
+void
+ThreeProngFinder::setup(float bz)
+{
+  mBz = bz;
+  mFitter.setup(bz);
+}
+
+/*****************************************************************/
+
+void
+ThreeProngFinder::clear()
+{
+  mTracks.clear();
+  mProngs.clear();
+  mFound.clear();
+}
+
+/*****************************************************************/
+
+void
+ThreeProngFinder::addTrack(const O2Track &o2track, int index)
+{
+  if (o2track.getCharge() == 0 || o2track.getPt() < mMinPt) return;
+  Prong prong;
+  prong.track = o2track;
+  prong.index = index;
+  prong.cell = mCells.findCell(o2track.getEta(), o2track.getPhi());
+  prong.charge = o2track.getCharge() > 0 ? 1 : -1;
+  mTracks.push_back(prong);
+}
+
+/*****************************************************************/
+
+int
+ThreeProngFinder::massFlags(const Prong &kaon, const Prong &prong1, const Prong &prong2) const
+{
+  auto inWindow = [this](float mass, float target) { return std::abs(mass - target) < mMassWindow; };
+  int flags = 0;
+  if (inWindow(TrackUtils::invariantMass(kaon.p, kMassKaon, prong1.p, kMassPion, prong2.p, kMassPion), kMassDplus))
+    flags |= 1 << kDplusToPiKPi;
+  if (inWindow(TrackUtils::invariantMass(kaon.p, kMassKaon, prong1.p, kMassProton, prong2.p, kMassPion), kMassLc) ||
+      inWindow(TrackUtils::invariantMass(kaon.p, kMassKaon, prong1.p, kMassPion, prong2.p, kMassProton), kMassLc))
+    flags |= 1 << kLcToPKPi;
+  if (inWindow(TrackUtils::invariantMass(kaon.p, kMassKaon, prong1.p, kMassKaon, prong2.p, kMassPion), kMassDs) ||
+      inWindow(TrackUtils::invariantMass(kaon.p, kMassKaon, prong1.p, kMassPion, prong2.p, kMassKaon), kMassDs))
+    flags |= 1 << kDsToKKPi;
+  return flags;
+}
+
+/*****************************************************************/
+
+int
+ThreeProngFinder::process(std::array<float, 3> pv)
+{
+  mProngs.clear();
+  mFound.clear();
+
+  // preselection: prongs do not point to the primary vertex, momenta at the DCA for the mass windows
+  for (auto &t : mTracks) {
+    O2Track dca = t.track;
+    if (!TrackUtils::propagateToDCA(dca, pv, mBz)) continue;
+    auto xyz = dca.getXYZGlo();
+    if (std::hypot(xyz.X() - pv[0], xyz.Y() - pv[1]) < mMinDCAToPV) continue;
+    mProngs.push_back(t);
+    dca.getPxPyPzGlo(mProngs.back().p);
+  }
+
+  // bucket the prongs by eta-phi cell
+  const int nProngs = mProngs.size();
+  std::vector<int> cells(nProngs);
+  for (int i = 0; i < nProngs; ++i)
+    cells[i] = mProngs[i].cell;
+  mCells.fill(cells);
+
+  // triplets with all the prongs in neighbouring cells, i is the lowest index
+  std::vector<int> near;
+  for (int i = 0; i < nProngs; ++i) {
+    auto &first = mProngs[i];
+    near.clear();
+    mCells.forNeighbours(first.cell, [&](int j) {
+      if (j > i) near.push_back(j);
+    });
+
+    for (int a = 0; a < (int)near.size(); ++a) {
+      auto &second = mProngs[near[a]];
+      for (int b = a + 1; b < (int)near.size(); ++b) {
+        auto &third = mProngs[near[b]];
+        // cheap cuts first: charge, cells, candidate pt and mass windows
+        if (std::abs(first.charge + second.charge + third.charge) != 1) continue;
+        if (!mCells.areNeighbours(second.cell, third.cell)) continue;
+        float px = first.p[0] + second.p[0] + third.p[0], py = first.p[1] + second.p[1] + third.p[1];
+        if (std::hypot(px, py) < mMinCandidatePt) continue;
+        int flags;
+        if (second.charge == third.charge) flags = massFlags(first, second, third);
+        else if (first.charge == third.charge) flags = massFlags(second, first, third);
+        else flags = massFlags(third, first, second);
+        if (!flags) continue;
+
+        Candidate candidate;
+        O2Track parent;
+        if (!mFitter.fitVertex(first.track, second.track, third.track, candidate.vertex, parent)) continue;
+        candidate.chi2 = mFitter.getChi2Prong3();
+        if (candidate.chi2 > mMaxChi2) continue;
+        float dx = candidate.vertex.x - pv[0], dy = candidate.vertex.y - pv[1], dz = candidate.vertex.z - pv[2];
+        candidate.decayLength = std::sqrt(dx * dx + dy * dy + dz * dz);
+        if (candidate.decayLength < mMinDecayLength) continue;
+        std::array<float, 3> p;
+        parent.getPxPyPzGlo(p);
+        float norm = candidate.decayLength * std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        candidate.cosPA = norm > 0. ? (dx * p[0] + dy * p[1] + dz * p[2]) / norm : -1.;
+        if (candidate.cosPA < mMinCosPA) continue;
+        candidate.prongs = {first.index, second.index, third.index};
+        candidate.flags = flags;
+        mFound.push_back(candidate);
+      }
+    }
+  }
+
+  return mFound.size();
+}
+
+/*****************************************************************/
+
+} /** namespace delphes **/
+} /** namespace o2 **/
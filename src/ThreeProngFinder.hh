@@ -0,0 +1,88 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _DelphesO2_ThreeProngFinder_h_
+#define _DelphesO2_ThreeProngFinder_h_
+
+#include "VertexFitter.hh"
+#include "TrackUtils.hh"
+#include <array>
+#include <vector>
+
+namespace o2
+{
+namespace delphes
+{
+
+/// three-prong heavy-flavour candidates on the smeared tracks of one collision.
+/// Triplets are built within neighbouring eta-phi cells only, with charge,
+/// pt and mass-window preselection before the DCAFitterN<3> fit
+
+class ThreeProngFinder {
+
+public:
+  ThreeProngFinder() = default;
+  ~ThreeProngFinder() = default;
+
+  // decay hypotheses, the opposite-sign prong is the kaon in all of them
+  enum { kDplusToPiKPi = 0, kLcToPKPi, kDsToKKPi, kNHypotheses };
+
+  struct Candidate {
+    std::array<int, 3> prongs; // track indices, as given to addTrack
+    int flags;                 // hypotheses within the mass window, one bit each
+    Vertex vertex;             // [cm]
+    float chi2;
+    float cosPA;
+    float decayLength;         // [cm]
+  };
+
+  void setup(float bz); // [T]
+  void setCells(int nEta, int nPhi, float etaMax) { mCells.setCells(nEta, nPhi, etaMax); };
+
+  void setMinPt(float val) { mMinPt = val; };
+  void setMinDCAToPV(float val) { mMinDCAToPV = val; };
+  void setMinCandidatePt(float val) { mMinCandidatePt = val; };
+  void setMassWindow(float val) { mMassWindow = val; };
+  void setMaxChi2(float val) { mMaxChi2 = val; };
+  void setMinCosPA(float val) { mMinCosPA = val; };
+  void setMinDecayLength(float val) { mMinDecayLength = val; };
+
+  void clear();
+  void addTrack(const O2Track &o2track, int index);
+  int process(std::array<float, 3> pv);
+
+  const std::vector<Candidate> &getCandidates() const { return mFound; };
+
+protected:
+
+  struct Prong {
+    O2Track track;
+    int index;
+    int cell;
+    int charge;
+    std::array<float, 3> p; // at the DCA to the primary vertex
+  };
+
+  int massFlags(const Prong &kaon, const Prong &prong1, const Prong &prong2) const;
+
+  VertexFitter mFitter;
+  float mBz = 0.5; // [T]
+
+  float mMinPt = 0.3;          // [GeV/c]
+  float mMinDCAToPV = 0.002;   // [cm]
+  float mMinCandidatePt = 1.;  // [GeV/c]
+  float mMassWindow = 0.2;     // [GeV/c2]
+  float mMaxChi2 = 0.01;       // [cm2]
+  float mMinCosPA = 0.9;
+  float mMinDecayLength = 0.;  // [cm]
+
+  std::vector<Prong> mTracks;
+  std::vector<Prong> mProngs;
+  EtaPhiCells mCells;
+  std::vector<Candidate> mFound;
+};
+
+} /** namespace delphes **/
+} /** namespace o2 **/
+
+#endif /** _DelphesO2_ThreeProngFinder_h_ **/
@@ -0,0 +1,72 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "TrackAssociator.hh"
+#include <algorithm>
+
+namespace o2
+{
+namespace delphes
+{
+
+/*****************************************************************/
+
+void
+TrackAssociator::clear()
+{
+  mCollisions.clear();
+  mTracks.clear();
+  mAssociations.clear();
+  mAmbiguous.clear();
+  mNOrphans = 0;
+}
+
+/*****************************************************************/
+
+void
+TrackAssociator::addCollision(int index, double time, int bc)
+{
+  mCollisions.push_back({time, index, bc});
+}
+
+/*****************************************************************/
+
+void
+TrackAssociator::addTrack(int index, double time, double timeRes)
+{
+  mTracks.push_back({time, timeRes, index});
+}
+
+/*****************************************************************/
+
+void
+TrackAssociator::process()
+{
+  mAssociations.clear();
+  mAmbiguous.clear();
+  mNOrphans = 0;
+
+  std::stable_sort(mCollisions.begin(), mCollisions.end(),
+                   [](const Collision &a, const Collision &b) { return a.time < b.time; });
+
+  for (auto &track : mTracks) {
+    const double window = mNSigma * track.timeRes;
+    auto first = std::lower_bound(mCollisions.begin(), mCollisions.end(), track.time - window,
+                                  [](const Collision &c, double t) { return c.time < t; });
+    int nCompatible = 0;
+    Ambiguous ambiguous = {track.index, {0, 0}};
+    for (auto it = first; it != mCollisions.end() && it->time <= track.time + window; ++it) {
+      mAssociations.push_back({track.index, it->index});
+      if (nCompatible == 0 || it->bc < ambiguous.bc[0]) ambiguous.bc[0] = it->bc;
+      if (nCompatible == 0 || it->bc > ambiguous.bc[1]) ambiguous.bc[1] = it->bc;
+      nCompatible++;
+    }
+    if (nCompatible == 0) mNOrphans++;
+    else if (nCompatible > 1) mAmbiguous.push_back(ambiguous);
+  }
+}
+
+/*****************************************************************/
+
+} /** namespace delphes **/
+} /** namespace o2 **/
@@ -0,0 +1,70 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _DelphesO2_TrackAssociator_h_
+#define _DelphesO2_TrackAssociator_h_
+
+#include <vector>
+
+namespace o2
+{
+namespace delphes
+{
+
+/// time-window association of tracks to collisions: a track is compatible
+/// with every collision within nSigma of its time resolution. Collisions are
+/// sorted by time once, each track is a binary search and a scan of its window
+
+class TrackAssociator {
+
+public:
+  TrackAssociator() = default;
+  ~TrackAssociator() = default;
+
+  struct Association {
+    int track;
+    int collision;
+  };
+
+  struct Ambiguous {
+    int track;
+    int bc[2]; // first and last BC of the compatible collisions
+  };
+
+  void setNSigma(float val) { mNSigma = val; };
+
+  void clear();
+  void addCollision(int index, double time, int bc);    // [us]
+  void addTrack(int index, double time, double timeRes); // [us]
+  void process();
+
+  const std::vector<Association> &getAssociations() const { return mAssociations; };
+  const std::vector<Ambiguous> &getAmbiguous() const { return mAmbiguous; };
+  int getNOrphans() const { return mNOrphans; };
+
+protected:
+
+  struct Collision {
+    double time;
+    int index;
+    int bc;
+  };
+
+  struct TimedTrack {
+    double time, timeRes;
+    int index;
+  };
+
+  float mNSigma = 4.;
+
+  std::vector<Collision> mCollisions;
+  std::vector<TimedTrack> mTracks;
+  std::vector<Association> mAssociations;
+  std::vector<Ambiguous> mAmbiguous;
+  int mNOrphans = 0;
+};
+
+} /** namespace delphes **/
+} /** namespace o2 **/
+
+#endif /** _DelphesO2_TrackAssociator_h_ **/
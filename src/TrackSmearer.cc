@@ -4,8 +4,10 @@
 #include "TrackSmearer.hh"
 #include "TrackUtils.hh"
 #include "TRandom.h"
+#include "TDatabasePDG.h"
 #include <iostream>
 #include <fstream>
+#include <cmath>
 
 namespace o2
 {
@@ -17,60 +19,298 @@ namespace delphes
 bool
 TrackSmearer::loadTable(int pdg, const char *filename, bool forceReload)
 {
-  auto ipdg = getIndexPDG(pdg);
-  if (mLUTHeader[ipdg] && !forceReload) {
-    std::cout << " --- LUT table for PDG " << pdg << " has been already loaded with index " << ipdg << std::endl;
+  auto ipdg = prepareSlot(pdg, forceReload);
+  if (ipdg < 0) return false;
+  if (!readTable(pdg, filename, mLUTHeader[ipdg], mLUTEntry[ipdg])) {
+    releaseSlot(pdg, ipdg);
+    return false;
+  }
+  std::cout << " --- read covariance matrix table for PDG " << pdg << ": " << filename << std::endl;
+  mLUTHeader[ipdg]->print();
+  halveTable(ipdg);
+  registerTable(pdg, ipdg);
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+TrackSmearer::loadTableFamily(int pdg, const std::map<float, std::string> &filenames, bool forceReload)
+{
+  if (filenames.empty()) return false;
+  if (mBz == 0.) {
+    std::cout << " --- magnetic field not set, cannot interpolate LUT family for PDG " << pdg << std::endl;
+    return false;
+  }
+  // bracketing fields, the nearest one outside of the family
+  auto bz = std::abs(mBz);
+  auto hi = filenames.lower_bound(bz);
+  if (hi == filenames.end()) --hi;
+  auto lo = hi;
+  if (hi->first > bz && hi != filenames.begin()) --lo;
+  if (bz < lo->first || bz > hi->first)
+    std::cout << " --- Bz = " << bz << " T is outside of the LUT family for PDG " << pdg << ", extrapolating from " << lo->first << " T" << std::endl;
+
+  auto ipdg = prepareSlot(pdg, forceReload);
+  if (ipdg < 0) return false;
+  if (!readTable(pdg, lo->second.c_str(), mLUTHeader[ipdg], mLUTEntry[ipdg])) {
+    releaseSlot(pdg, ipdg);
+    return false;
+  }
+  lutHeader_t *hiHeader = nullptr;
+  lutEntry_t *****hiEntry = nullptr;
+  if (hi != lo && !readTable(pdg, hi->second.c_str(), hiHeader, hiEntry)) {
+    deleteTable(mLUTHeader[ipdg], mLUTEntry[ipdg]);
+    releaseSlot(pdg, ipdg);
     return false;
   }
-  mLUTHeader[ipdg] = new lutHeader_t;
+  auto lutHeader = mLUTHeader[ipdg];
+  if (hiHeader && !(lutHeader->nchmap == hiHeader->nchmap && lutHeader->radmap == hiHeader->radmap &&
+                    lutHeader->etamap == hiHeader->etamap && lutHeader->ptmap == hiHeader->ptmap)) {
+    std::cout << " --- LUT family binning mismatch for PDG " << pdg << ": " << lo->second << " / " << hi->second << std::endl;
+    deleteTable(hiHeader, hiEntry);
+    deleteTable(mLUTHeader[ipdg], mLUTEntry[ipdg]);
+    releaseSlot(pdg, ipdg);
+    return false;
+  }
+
+  // the q/pt terms scale as 1/Bz, interpolate linearly what is left
+  const float b0 = lutHeader->field, b1 = hiHeader ? hiHeader->field : b0;
+  const float w = b1 != b0 ? (bz - b0) / (b1 - b0) : 0.;
+  const float s0 = b0 / bz, s1 = b1 / bz;
+  for (int inch = 0; inch < lutHeader->nchmap.nbins; ++inch)
+    for (int irad = 0; irad < lutHeader->radmap.nbins; ++irad)
+      for (int ieta = 0; ieta < lutHeader->etamap.nbins; ++ieta)
+        for (int ipt = 0; ipt < lutHeader->ptmap.nbins; ++ipt) {
+          auto e0 = mLUTEntry[ipdg][inch][irad][ieta][ipt];
+          auto e1 = hiHeader ? hiEntry[inch][irad][ieta][ipt] : e0;
+          e0->valid = e0->valid && e1->valid;
+          e0->eff = (1. - w) * e0->eff + w * e1->eff;
+          e0->eff2 = (1. - w) * e0->eff2 + w * e1->eff2;
+          e0->itof = (1. - w) * e0->itof + w * e1->itof;
+          e0->otof = (1. - w) * e0->otof + w * e1->otof;
+          for (int i = 0, k = 0; i < 5; ++i)
+            for (int j = 0; j < i + 1; ++j, ++k) {
+              int n = (i == 4) + (j == 4);
+              e0->covm[k] = (1. - w) * std::pow(s0, n) * e0->covm[k] + w * std::pow(s1, n) * e1->covm[k];
+            }
+          e0->cholesky();
+          decompose(*e0);
+        }
+  deleteTable(hiHeader, hiEntry);
+  lutHeader->field = bz;
+  std::cout << " --- interpolated covariance matrix table for PDG " << pdg << " to Bz = " << bz << " T: " << lo->second;
+  if (hi != lo) std::cout << " / " << hi->second;
+  std::cout << std::endl;
+  lutHeader->print();
+  halveTable(ipdg);
+  registerTable(pdg, ipdg);
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+TrackSmearer::setTableSolver(int pdg, const lutHeader_t &lutHeader, lutSolver_t solver, const char *filename, bool forceReload)
+{
+  if (!solver) return false;
+  auto ipdg = prepareSlot(pdg, forceReload);
+  if (ipdg < 0) return false;
+  // empty table, the bins are solved when first needed
+  mLUTHeader[ipdg] = new lutHeader_t(lutHeader);
+  const int nnch = lutHeader.nchmap.nbins;
+  const int nrad = lutHeader.radmap.nbins;
+  const int neta = lutHeader.etamap.nbins;
+  const int npt = lutHeader.ptmap.nbins;
+  auto &lutEntry = mLUTEntry[ipdg];
+  lutEntry = new lutEntry_t****[nnch];
+  for (int inch = 0; inch < nnch; ++inch) {
+    lutEntry[inch] = new lutEntry_t***[nrad];
+    for (int irad = 0; irad < nrad; ++irad) {
+      lutEntry[inch][irad] = new lutEntry_t**[neta];
+      for (int ieta = 0; ieta < neta; ++ieta)
+        lutEntry[inch][irad][ieta] = new lutEntry_t*[npt]();
+    }
+  }
+  mSolver[ipdg] = solver;
+
+  // bins solved in previous runs, new ones are appended
+  if (filename && filename[0]) {
+    auto nsolved = readSolved(ipdg, filename);
+    auto mode = nsolved < 0 ? std::ofstream::binary : std::ofstream::binary | std::ofstream::app;
+    mSolvedFile[ipdg] = std::make_shared<std::ofstream>(filename, mode);
+    if (!mSolvedFile[ipdg]->is_open()) {
+      std::cout << " --- cannot open file of solved bins for PDG " << pdg << ": " << filename << std::endl;
+      mSolvedFile[ipdg].reset();
+    } else if (nsolved < 0) {
+      mSolvedFile[ipdg]->write(reinterpret_cast<const char *>(&lutHeader), sizeof(lutHeader_t));
+    } else {
+      std::cout << " --- read " << nsolved << " solved bins for PDG " << pdg << ": " << filename << std::endl;
+    }
+  }
+  std::cout << " --- covariance matrix table for PDG " << pdg << " is solved on demand" << std::endl;
+  mLUTHeader[ipdg]->print();
+  registerTable(pdg, ipdg);
+  return true;
+}
+
+/*****************************************************************/
+
+int
+TrackSmearer::readSolved(int ipdg, const char *filename)
+{
+  // header followed by (bin index, entry) records, -1 if missing or for another table
+  std::ifstream solvedFile(filename, std::ifstream::binary);
+  if (!solvedFile.is_open()) return -1;
+  auto lutHeader = mLUTHeader[ipdg];
+  lutHeader_t solvedHeader;
+  solvedFile.read(reinterpret_cast<char *>(&solvedHeader), sizeof(lutHeader_t));
+  if (solvedFile.gcount() != sizeof(lutHeader_t) || !(solvedHeader == *lutHeader)) {
+    std::cout << " --- file of solved bins does not match the table for PDG " << lutHeader->pdg << ", starting over: " << filename << std::endl;
+    return -1;
+  }
+  const int nrad = lutHeader->radmap.nbins;
+  const int neta = lutHeader->etamap.nbins;
+  const int npt = lutHeader->ptmap.nbins;
+  const int nbins = lutHeader->nchmap.nbins * nrad * neta * npt;
+  int nsolved = 0, key;
+  lutEntry_t entry;
+  while (solvedFile.read(reinterpret_cast<char *>(&key), sizeof(int)) &&
+         solvedFile.read(reinterpret_cast<char *>(&entry), sizeof(lutEntry_t))) {
+    if (key < 0 || key >= nbins) continue;
+    auto &lutEntry = mLUTEntry[ipdg][key / npt / neta / nrad][(key / npt / neta) % nrad][(key / npt) % neta][key % npt];
+    if (!lutEntry) lutEntry = new lutEntry_t(entry);
+    nsolved++;
+  }
+  return nsolved;
+}
+
+/*****************************************************************/
+
+lutEntry_t *
+TrackSmearer::solveEntry(int ipdg, int inch, int irad, int ieta, int ipt)
+{
+  auto lutHeader = mLUTHeader[ipdg];
+  auto lutEntry = new lutEntry_t;
+  lutEntry->nch = lutHeader->nchmap.eval(inch);
+  if (!mSolver[ipdg](*lutEntry, *lutHeader, inch, irad, ieta, ipt))
+    lutEntry->valid = false;
+  lutEntry->cholesky();
+  decompose(*lutEntry);
+  mLUTEntry[ipdg][inch][irad][ieta][ipt] = lutEntry;
+  if (mSolvedFile[ipdg]) {
+    int key = ((inch * lutHeader->radmap.nbins + irad) * lutHeader->etamap.nbins + ieta) * lutHeader->ptmap.nbins + ipt;
+    mSolvedFile[ipdg]->write(reinterpret_cast<const char *>(&key), sizeof(int));
+    mSolvedFile[ipdg]->write(reinterpret_cast<const char *>(lutEntry), sizeof(lutEntry_t));
+    mSolvedFile[ipdg]->flush();
+  }
+  return lutEntry;
+}
+
+/*****************************************************************/
+
+int
+TrackSmearer::prepareSlot(int pdg, bool forceReload)
+{
+  auto it = mPDGToSlot.find(abs(pdg));
+  int ipdg = it != mPDGToSlot.end() ? it->second.slot : -1;
+  if (ipdg >= 0 && mLUTHeader[ipdg] && !forceReload) {
+    std::cout << " --- LUT table for PDG " << pdg << " has been already loaded with index " << ipdg << std::endl;
+    return -1;
+  }
+  if (ipdg < 0) { // new species slot, the one of a failed load is reused
+    for (int islot = 0; islot < (int)mLUTHeader.size() && ipdg < 0; ++islot) {
+      if (mLUTHeader[islot]) continue;
+      ipdg = islot;
+      for (auto &e : mPDGToSlot)
+        if (e.second.slot == islot) ipdg = -1;
+    }
+  }
+  if (ipdg < 0) {
+    ipdg = mLUTHeader.size();
+    mLUTHeader.push_back(nullptr);
+    mLUTEntry.push_back(nullptr);
+    mEtaMirrored.push_back(false);
+    mSolver.emplace_back();
+    mSolvedFile.emplace_back();
+    mInterpolationCell.emplace_back();
+  }
+  // the species is bound to the slot by registerTable, once its table is there
+  deleteTable(mLUTHeader[ipdg], mLUTEntry[ipdg]); // the table being reloaded
+  mInterpolationCell[ipdg].clear();
+  mEtaMirrored[ipdg] = false;
+  mSolver[ipdg] = nullptr;
+  mSolvedFile[ipdg].reset();
+  return ipdg;
+}
+
+/*****************************************************************/
+
+bool
+TrackSmearer::readTable(int pdg, const char *filename, lutHeader_t *&lutHeader, lutEntry_t *****&lutEntry)
+{
+  lutHeader = new lutHeader_t;
   
   std::ifstream lutFile(filename, std::ifstream::binary);
   if (!lutFile.is_open()) {
     std::cout << " --- cannot open covariance matrix file for PDG " << pdg << ": " << filename << std::endl;
-    delete mLUTHeader[ipdg];
-    mLUTHeader[ipdg] = nullptr;
+    delete lutHeader;
+    lutHeader = nullptr;
     return false;
   }
-  lutFile.read(reinterpret_cast<char *>(mLUTHeader[ipdg]), sizeof(lutHeader_t));
+  lutFile.read(reinterpret_cast<char *>(lutHeader), sizeof(lutHeader_t));
   if (lutFile.gcount() != sizeof(lutHeader_t)) {
     std::cout << " --- troubles reading covariance matrix header for PDG " << pdg << ": " << filename << std::endl;
-    delete mLUTHeader[ipdg];
-    mLUTHeader[ipdg] = nullptr;
+    delete lutHeader;
+    lutHeader = nullptr;
     return false;
   }
-  if (mLUTHeader[ipdg]->version != LUTCOVM_VERSION) {
-    std::cout << " --- LUT header version mismatch: expected/detected = " << LUTCOVM_VERSION << "/" << mLUTHeader[ipdg]->version << std::endl;
-    delete mLUTHeader[ipdg];
-    mLUTHeader[ipdg] = nullptr;
+  if (lutHeader->version != LUTCOVM_VERSION) {
+    std::cout << " --- LUT header version mismatch: expected/detected = " << LUTCOVM_VERSION << "/" << lutHeader->version << std::endl;
+    delete lutHeader;
+    lutHeader = nullptr;
     return false;
   }
-  if (mLUTHeader[ipdg]->pdg != pdg) {
-    std::cout << " --- LUT header PDG mismatch: expected/detected = " << pdg << "/" << mLUTHeader[ipdg]->pdg << std::endl;
-    delete mLUTHeader[ipdg];
-    mLUTHeader[ipdg] = nullptr;
+  if (lutHeader->pdg != pdg) {
+    std::cout << " --- LUT header PDG mismatch: expected/detected = " << pdg << "/" << lutHeader->pdg << std::endl;
+    delete lutHeader;
+    lutHeader = nullptr;
     return false;
   }
-  const int nnch = mLUTHeader[ipdg]->nchmap.nbins;
-  const int nrad = mLUTHeader[ipdg]->radmap.nbins;
-  const int neta = mLUTHeader[ipdg]->etamap.nbins;
-  const int npt = mLUTHeader[ipdg]->ptmap.nbins;
-  mLUTEntry[ipdg] = new lutEntry_t****[nnch];
+  const int nnch = lutHeader->nchmap.nbins;
+  const int nrad = lutHeader->radmap.nbins;
+  const int neta = lutHeader->etamap.nbins;
+  const int npt = lutHeader->ptmap.nbins;
+  int nDecomposed = 0;
+  // the arrays start empty, so that a partially read table can be freed
+  lutEntry = new lutEntry_t****[nnch]();
   for (int inch = 0; inch < nnch; ++inch) {
-    mLUTEntry[ipdg][inch] = new lutEntry_t***[nrad];
+    lutEntry[inch] = new lutEntry_t***[nrad]();
     for (int irad = 0; irad < nrad; ++irad) {
-      mLUTEntry[ipdg][inch][irad] = new lutEntry_t**[neta];
+      lutEntry[inch][irad] = new lutEntry_t**[neta]();
       for (int ieta = 0; ieta < neta; ++ieta) {
-	mLUTEntry[ipdg][inch][irad][ieta] = new lutEntry_t*[npt];
+	lutEntry[inch][irad][ieta] = new lutEntry_t*[npt]();
 	for (int ipt = 0; ipt < npt; ++ipt) {
-	  mLUTEntry[ipdg][inch][irad][ieta][ipt] = new lutEntry_t;
-	  lutFile.read(reinterpret_cast<char *>(mLUTEntry[ipdg][inch][irad][ieta][ipt]), sizeof(lutEntry_t));
+	  lutEntry[inch][irad][ieta][ipt] = new lutEntry_t;
+	  lutFile.read(reinterpret_cast<char *>(lutEntry[inch][irad][ieta][ipt]), sizeof(lutEntry_t));
 	  if (lutFile.gcount() != sizeof(lutEntry_t)) {
 	    std::cout << " --- troubles reading covariance matrix entry for PDG " << pdg << ": " << filename << std::endl;
+	    deleteTable(lutHeader, lutEntry);
 	    return false;
 	  }
+	  // LUTs written without the eigen decomposition (lut-writer --no-eigen) only store the Cholesky factor
+	  auto &entry = *lutEntry[inch][irad][ieta][ipt];
+	  bool hasEigen = false;
+	  for (int i = 0; i < 5 && !hasEigen; ++i)
+	    for (int j = 0; j < 5 && !hasEigen; ++j)
+	      hasEigen = entry.eigvec[i][j] != 0.;
+	  if (!hasEigen) {
+	    decompose(entry);
+	    nDecomposed++;
+	  }
 	}}}}
-  std::cout << " --- read covariance matrix table for PDG " << pdg << ": " << filename << std::endl;
-  mLUTHeader[ipdg]->print();
+  if (nDecomposed > 0)
+    std::cout << " --- eigen decomposition rebuilt for " << nDecomposed << " entries of the table for PDG " << pdg << ": " << filename << std::endl;
 
   lutFile.close();
   return true;
@@ -78,20 +318,469 @@ TrackSmearer::loadTable(int pdg, const char *filename, bool forceReload)
 
 /*****************************************************************/
 
+void
+TrackSmearer::deleteTable(lutHeader_t *&lutHeader, lutEntry_t *****&lutEntry)
+{
+  // frees a table, also a partially filled one: the missing arrays and entries are null
+  if (lutHeader && lutEntry) {
+    for (int inch = 0; inch < lutHeader->nchmap.nbins && lutEntry[inch]; ++inch) {
+      for (int irad = 0; irad < lutHeader->radmap.nbins && lutEntry[inch][irad]; ++irad) {
+        for (int ieta = 0; ieta < lutHeader->etamap.nbins && lutEntry[inch][irad][ieta]; ++ieta) {
+          for (int ipt = 0; ipt < lutHeader->ptmap.nbins; ++ipt)
+            delete lutEntry[inch][irad][ieta][ipt];
+          delete [] lutEntry[inch][irad][ieta];
+        }
+        delete [] lutEntry[inch][irad];
+      }
+      delete [] lutEntry[inch];
+    }
+    delete [] lutEntry;
+  }
+  lutEntry = nullptr;
+  delete lutHeader;
+  lutHeader = nullptr;
+}
+
+/*****************************************************************/
+
+void
+TrackSmearer::registerTable(int pdg, int ipdg)
+{
+  auto &link = mPDGToSlot[abs(pdg)];
+  float mass;
+  link.slot = ipdg;
+  link.mass = mLUTHeader[ipdg]->mass;
+  if (pdg == 0 || !findMassCharge(pdg, mass, link.charge)) link.charge = 1.;
+  checkField(mLUTHeader[ipdg]);
+
+  // fallbacks are resolved again against the new table
+  mFallbackLink.clear();
+}
+
+/*****************************************************************/
+
+void
+TrackSmearer::releaseSlot(int pdg, int ipdg)
+{
+  // after a failed load, the species is no longer bound to the emptied slot and can fall back
+  auto it = mPDGToSlot.find(abs(pdg));
+  if (it != mPDGToSlot.end() && it->second.slot == ipdg) mPDGToSlot.erase(it);
+  mFallbackLink.clear();
+}
+
+/*****************************************************************/
+
+bool
+TrackSmearer::halveTable(int ipdg)
+{
+  // tables symmetric in eta only keep the eta >= 0 half, the rest is mirrored on lookup
+  auto lutHeader = mLUTHeader[ipdg];
+  if (lutHeader->etamap.min != -lutHeader->etamap.max) return false;
+  const int nnch = lutHeader->nchmap.nbins;
+  const int nrad = lutHeader->radmap.nbins;
+  const int neta = lutHeader->etamap.nbins;
+  const int npt = lutHeader->ptmap.nbins;
+  auto lutEntry = mLUTEntry[ipdg];
+  for (int inch = 0; inch < nnch; ++inch)
+    for (int irad = 0; irad < nrad; ++irad)
+      for (int ieta = 0; ieta < neta / 2; ++ieta)
+        for (int ipt = 0; ipt < npt; ++ipt)
+          if (!lutEntry[inch][irad][ieta][ipt]->isMirrorOf(*lutEntry[inch][irad][neta - 1 - ieta][ipt])) return false;
+  for (int inch = 0; inch < nnch; ++inch)
+    for (int irad = 0; irad < nrad; ++irad)
+      for (int ieta = 0; ieta < neta / 2; ++ieta)
+        for (int ipt = 0; ipt < npt; ++ipt) {
+          delete lutEntry[inch][irad][ieta][ipt];
+          lutEntry[inch][irad][ieta][ipt] = nullptr;
+        }
+  mEtaMirrored[ipdg] = true;
+  std::cout << " --- LUT for PDG " << lutHeader->pdg << " is symmetric in eta, storing eta >= 0 only" << std::endl;
+  return true;
+}
+
+/*****************************************************************/
+
+lutEntry_t *
+TrackSmearer::getEntry(int ipdg, int inch, int irad, int ieta, int ipt)
+{
+  auto lutEntry = mLUTEntry[ipdg][inch][irad][ieta][ipt];
+  if (lutEntry) return lutEntry;
+  if (mSolver[ipdg]) return solveEntry(ipdg, inch, irad, ieta, ipt);
+  // not stored, mirror of the bin at -eta
+  auto lutHeader = mLUTHeader[ipdg];
+  mMirroredEntry = *mLUTEntry[ipdg][inch][irad][lutHeader->etamap.nbins - 1 - ieta][ipt];
+  mMirroredEntry.mirror();
+  mMirroredEntry.eta = lutHeader->etamap.eval(ieta);
+  return &mMirroredEntry;
+}
+
+/*****************************************************************/
+
+void
+TrackSmearer::setBz(float val)
+{
+  mBz = val;
+  for (auto lutHeader : mLUTHeader)
+    checkField(lutHeader);
+}
+
+/*****************************************************************/
+
+bool
+TrackSmearer::checkField(const lutHeader_t *lutHeader) const
+{
+  if (!lutHeader || mBz == 0.) return true;
+  if (std::abs(std::abs(mBz) - lutHeader->field) < 1.e-3) return true;
+  std::cout << " --- WARNING: LUT for PDG " << lutHeader->pdg << " was written for field " << lutHeader->field << " T, running at Bz = " << mBz << " T" << std::endl;
+  return false;
+}
+
+/*****************************************************************/
+
+const TrackSmearer::speciesLink_t &
+TrackSmearer::getSpecies(int pdg)
+{
+  auto it = mPDGToSlot.find(abs(pdg));
+  if (it != mPDGToSlot.end()) return it->second;
+  auto fit = mFallbackLink.find(abs(pdg));
+  if (fit != mFallbackLink.end()) return fit->second;
+
+  // resolve the fallback once for this species
+  auto &link = mFallbackLink[abs(pdg)];
+  link.fallback = true;
+  if (mFallback == kFallbackReject || !findMassCharge(pdg, link.mass, link.charge)) {
+    std::cout << " --- no LUT for PDG " << pdg << ", tracks will be rejected" << std::endl;
+    return link;
+  }
+  auto iuniversal = getUniversalSlot();
+  if (iuniversal >= 0 && link.mass > 0.) {
+    link.slot = iuniversal;
+  } else if (mFallback == kFallbackScaledPion) {
+    auto pit = mPDGToSlot.find(211);
+    if (pit != mPDGToSlot.end() && mLUTHeader[pit->second.slot] && link.mass > 0.) {
+      link.slot = pit->second.slot;
+      link.scaled = true;
+    }
+  } else if (mFallback == kFallbackNearestMass) {
+    float dmass = 0.;
+    for (auto &e : mPDGToSlot) {
+      auto lutHeader = mLUTHeader[e.second.slot];
+      if (!lutHeader || lutHeader->pdg == 0) continue;
+      if (e.second.charge != link.charge) continue;
+      if (link.slot < 0 || std::abs(lutHeader->mass - link.mass) < dmass) {
+        link.slot = e.second.slot;
+        dmass = std::abs(lutHeader->mass - link.mass);
+      }
+    }
+  }
+  if (link.slot < 0)
+    std::cout << " --- no LUT for PDG " << pdg << ", tracks will be rejected" << std::endl;
+  else if (link.slot == iuniversal)
+    std::cout << " --- no LUT for PDG " << pdg << ", using the universal LUT" << std::endl;
+  else
+    std::cout << " --- no LUT for PDG " << pdg << ", using LUT for PDG " << mLUTHeader[link.slot]->pdg << (link.scaled ? " at the same beta-gamma" : "") << std::endl;
+  return link;
+}
+
+/*****************************************************************/
+
+void
+TrackSmearer::setSpecies(int pdg, float mass, float charge)
+{
+  mMassCharge[abs(pdg)] = {mass, std::abs(charge)};
+  auto it = mPDGToSlot.find(abs(pdg));
+  if (it != mPDGToSlot.end()) it->second.charge = std::abs(charge);
+  mFallbackLink.clear();
+}
+
+/*****************************************************************/
+
+bool
+TrackSmearer::findMassCharge(int pdg, float &mass, float &charge) const
+{
+  // set by the user first, then TDatabasePDG, then the nucleus code 10LZZZAAAI
+  auto it = mMassCharge.find(abs(pdg));
+  if (it != mMassCharge.end()) {
+    mass = it->second.first;
+    charge = it->second.second;
+    return true;
+  }
+  auto particle = TDatabasePDG::Instance()->GetParticle(abs(pdg));
+  if (particle) {
+    mass = particle->Mass();
+    charge = particle->Charge() != 0. ? std::abs(particle->Charge()) / 3. : 1.;
+    return true;
+  }
+  if (abs(pdg) < 1000000000) return false;
+  const int nL = (abs(pdg) / 10000000) % 10;
+  const int Z = (abs(pdg) / 10000) % 1000;
+  const int A = (abs(pdg) / 10) % 1000;
+  if (A == 0 || Z + nL > A) return false;
+  // free nucleon and Lambda masses, the binding energy is neglected
+  mass = (Z * 0.938272 + (A - Z - nL) * 0.939565 + nL * 1.115683);
+  charge = Z > 0 ? Z : 1.;
+  return true;
+}
+
+/*****************************************************************/
+
+int
+TrackSmearer::getUniversalSlot() const
+{
+  auto it = mPDGToSlot.find(0);
+  if (it == mPDGToSlot.end() || !mLUTHeader[it->second.slot]) return -1;
+  return it->second.slot;
+}
+
+/*****************************************************************/
+
+long
+TrackSmearer::getNumberOfFallbacks() const
+{
+  long n = 0;
+  for (auto &e : mFallbackCount) n += e.second;
+  return n;
+}
+
+/*****************************************************************/
+
+void
+TrackSmearer::printFallbacks() const
+{
+  for (auto &e : mFallbackCount)
+    std::cout << " --- PDG " << e.first << ": " << e.second << " tracks without own LUT" << std::endl;
+}
+
+/*****************************************************************/
+
 lutEntry_t *
 TrackSmearer::getLUTEntry(int pdg, float nch, float radius, float eta, float pt)
 {
   auto ipdg = getIndexPDG(pdg);
+  if (ipdg < 0) return nullptr;
+  return getLUTEntryAt(ipdg, nch, radius, eta, pt);
+}
+
+/*****************************************************************/
+
+lutEntry_t *
+TrackSmearer::getLUTEntryAt(int ipdg, float nch, float radius, float eta, float pt)
+{
   if (!mLUTHeader[ipdg]) return nullptr;
   auto inch = mLUTHeader[ipdg]->nchmap.find(nch);
   auto irad = mLUTHeader[ipdg]->radmap.find(radius);
   auto ieta = mLUTHeader[ipdg]->etamap.find(eta);
   auto ipt  = mLUTHeader[ipdg]->ptmap.find(pt);
-  return mLUTEntry[ipdg][inch][irad][ieta][ipt];
+  return getEntry(ipdg, inch, irad, ieta, ipt);
 };
 
 /*****************************************************************/
 
+lutEntry_t *
+TrackSmearer::getInterpolatedLUTEntry(int pdg, float nch, float radius, float eta, float pt)
+{
+  auto ipdg = getIndexPDG(pdg);
+  if (ipdg < 0) return nullptr;
+  return getInterpolatedLUTEntryAt(ipdg, nch, radius, eta, pt);
+}
+
+/*****************************************************************/
+
+lutEntry_t *
+TrackSmearer::getInterpolatedLUTEntryAt(int ipdg, float nch, float radius, float eta, float pt)
+{
+  auto lutHeader = mLUTHeader[ipdg];
+  if (!lutHeader) return nullptr;
+  // multilinear in the map coordinates, i.e. log-linear for log-binned maps
+  int inch, ieta, ipt;
+  float fnch, feta, fpt;
+  lutHeader->nchmap.interp(nch, inch, fnch);
+  lutHeader->etamap.interp(eta, ieta, feta);
+  lutHeader->ptmap.interp(pt, ipt, fpt);
+  auto irad = lutHeader->radmap.find(radius);
+
+  // blend the valid corners of the cell
+  auto &lutEntry = mInterpolatedEntry;
+  lutEntry.nch = nch;
+  lutEntry.eta = eta;
+  lutEntry.pt = pt;
+  lutEntry.eff = lutEntry.eff2 = lutEntry.itof = lutEntry.otof = 0.;
+  for (int i = 0; i < 15; ++i) lutEntry.covm[i] = 0.;
+  float wsum = 0., wvalid = 0.;
+  for (int icorner = 0; icorner < 8; ++icorner) {
+    int dnch = icorner & 1, deta = (icorner >> 1) & 1, dpt = (icorner >> 2) & 1;
+    float w = (dnch ? fnch : 1. - fnch) * (deta ? feta : 1. - feta) * (dpt ? fpt : 1. - fpt);
+    if (w <= 0.) continue;
+    wsum += w;
+    auto corner = getEntry(ipdg, inch + dnch, irad, ieta + deta, ipt + dpt);
+    if (!corner->valid) continue;
+    wvalid += w;
+    lutEntry.eff += w * corner->eff;
+    lutEntry.eff2 += w * corner->eff2;
+    lutEntry.itof += w * corner->itof;
+    lutEntry.otof += w * corner->otof;
+    for (int i = 0; i < 15; ++i) lutEntry.covm[i] += w * corner->covm[i];
+  }
+  // valid if the nearest-bin lookup could have been valid
+  lutEntry.valid = wvalid > 0. && wvalid >= 0.5 * wsum;
+  if (!lutEntry.valid) return &lutEntry;
+  lutEntry.eff /= wvalid;
+  lutEntry.eff2 /= wvalid;
+  lutEntry.itof /= wvalid;
+  lutEntry.otof /= wvalid;
+  for (int i = 0; i < 15; ++i) lutEntry.covm[i] /= wvalid;
+  if (mSmearingMethod == kCholesky) {
+    lutEntry.cholesky();
+    return &lutEntry;
+  }
+
+  // project the blended covariance on the cached eigenbasis of the cell
+  auto cell = getInterpolationCell(ipdg, inch, irad, ieta, ipt);
+  double fcovm[5][5];
+  for (int i = 0, k = 0; i < 5; ++i)
+    for (int j = 0; j < i + 1; ++j, ++k)
+      fcovm[i][j] = fcovm[j][i] = lutEntry.covm[k];
+  for (int i = 0; i < 5; ++i) {
+    double val = 0.;
+    for (int j = 0; j < 5; ++j)
+      for (int k = 0; k < 5; ++k)
+        val += cell->eigvec[j][i] * fcovm[j][k] * cell->eigvec[k][i];
+    lutEntry.eigval[i] = val > 0. ? val : 0.;
+    for (int j = 0; j < 5; ++j) {
+      lutEntry.eigvec[i][j] = cell->eigvec[i][j];
+      lutEntry.eiginv[i][j] = cell->eiginv[i][j];
+    }
+  }
+  return &lutEntry;
+}
+
+/*****************************************************************/
+
+lutEntry_t *
+TrackSmearer::getInterpolationCell(int ipdg, int inch, int irad, int ieta, int ipt)
+{
+  auto lutHeader = mLUTHeader[ipdg];
+  const int nnch = lutHeader->nchmap.nbins;
+  const int nrad = lutHeader->radmap.nbins;
+  const int neta = lutHeader->etamap.nbins;
+  const int npt = lutHeader->ptmap.nbins;
+  int key = ((inch * nrad + irad) * neta + ieta) * npt + ipt;
+  auto it = mInterpolationCell[ipdg].find(key);
+  if (it != mInterpolationCell[ipdg].end()) return &it->second;
+
+  // eigenbasis of the average covariance of the valid corners
+  lutEntry_t cell;
+  int nvalid = 0;
+  for (int icorner = 0; icorner < 8; ++icorner) {
+    int jnch = inch + (icorner & 1), jeta = ieta + ((icorner >> 1) & 1), jpt = ipt + ((icorner >> 2) & 1);
+    if (jnch >= nnch || jeta >= neta || jpt >= npt) continue;
+    auto corner = getEntry(ipdg, jnch, irad, jeta, jpt);
+    if (!corner->valid) continue;
+    for (int i = 0; i < 15; ++i) cell.covm[i] += corner->covm[i];
+    nvalid++;
+  }
+  if (nvalid > 0)
+    for (int i = 0; i < 15; ++i) cell.covm[i] /= nvalid;
+  cell.valid = nvalid > 0;
+  diagonalise(cell.covm, cell.eigvec);
+  for (int i = 0; i < 5; ++i)
+    for (int j = 0; j < 5; ++j)
+      cell.eiginv[i][j] = cell.eigvec[j][i];
+  return &(mInterpolationCell[ipdg][key] = cell);
+}
+
+/*****************************************************************/
+
+lutEntry_t *
+TrackSmearer::scaleLUTEntry(const lutEntry_t *lutEntry, float covScale)
+{
+  // same beta-gamma: keep the relative pt resolution, scale the q/pt row and column
+  mScaledEntry = *lutEntry;
+  for (int k = 10; k < 15; ++k) {
+    mScaledEntry.covm[k] *= covScale;
+    mScaledEntry.chol[k] *= covScale;
+  }
+  mScaledEntry.covm[14] *= covScale;
+  if (mSmearingMethod == kCholesky) return &mScaledEntry;
+  decompose(mScaledEntry);
+  return &mScaledEntry;
+}
+
+/*****************************************************************/
+
+void
+TrackSmearer::decompose(lutEntry_t &lutEntry)
+{
+  // eigenbasis of the covariance, eigenvalues as projections to stay non-negative
+  diagonalise(lutEntry.covm, lutEntry.eigvec);
+  double fcovm[5][5];
+  for (int i = 0, k = 0; i < 5; ++i)
+    for (int j = 0; j < i + 1; ++j, ++k)
+      fcovm[i][j] = fcovm[j][i] = lutEntry.covm[k];
+  for (int i = 0; i < 5; ++i) {
+    double val = 0.;
+    for (int j = 0; j < 5; ++j)
+      for (int k = 0; k < 5; ++k)
+        val += lutEntry.eigvec[j][i] * fcovm[j][k] * lutEntry.eigvec[k][i];
+    lutEntry.eigval[i] = val > 0. ? val : 0.;
+    for (int j = 0; j < 5; ++j)
+      lutEntry.eiginv[i][j] = lutEntry.eigvec[j][i];
+  }
+}
+
+/*****************************************************************/
+
+void
+TrackSmearer::diagonalise(const float *covm, float eigvec[5][5])
+{
+  // cyclic Jacobi rotations, eigenvectors are stored as columns
+  double a[5][5], v[5][5];
+  for (int i = 0, k = 0; i < 5; ++i)
+    for (int j = 0; j < i + 1; ++j, ++k)
+      a[i][j] = a[j][i] = covm[k];
+  for (int i = 0; i < 5; ++i)
+    for (int j = 0; j < 5; ++j)
+      v[i][j] = (i == j) ? 1. : 0.;
+  for (int isweep = 0; isweep < 50; ++isweep) {
+    double off = 0., diag = 0.;
+    for (int p = 0; p < 5; ++p) {
+      diag += a[p][p] * a[p][p];
+      for (int q = p + 1; q < 5; ++q)
+        off += a[p][q] * a[p][q];
+    }
+    if (off <= 1.e-24 * diag) break;
+    for (int p = 0; p < 5; ++p) {
+      for (int q = p + 1; q < 5; ++q) {
+        if (a[p][q] == 0.) continue;
+        double theta = (a[q][q] - a[p][p]) / (2. * a[p][q]);
+        double t = (theta >= 0. ? 1. : -1.) / (fabs(theta) + sqrt(theta * theta + 1.));
+        double c = 1. / sqrt(t * t + 1.);
+        double s = t * c;
+        for (int k = 0; k < 5; ++k) {
+          double akp = a[k][p], akq = a[k][q];
+          a[k][p] = c * akp - s * akq;
+          a[k][q] = s * akp + c * akq;
+        }
+        for (int k = 0; k < 5; ++k) {
+          double apk = a[p][k], aqk = a[q][k];
+          a[p][k] = c * apk - s * aqk;
+          a[q][k] = s * apk + c * aqk;
+        }
+        for (int k = 0; k < 5; ++k) {
+          double vkp = v[k][p], vkq = v[k][q];
+          v[k][p] = c * vkp - s * vkq;
+          v[k][q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+  for (int i = 0; i < 5; ++i)
+    for (int j = 0; j < 5; ++j)
+      eigvec[i][j] = v[i][j];
+}
+
+/*****************************************************************/
+
 bool
 TrackSmearer::smearTrack(O2Track &o2track, lutEntry_t *lutEntry)
 {
@@ -103,20 +792,33 @@ TrackSmearer::smearTrack(O2Track &o2track, lutEntry_t *lutEntry)
     if (gRandom->Uniform() > eff)
       return false;
   }
-  // transform params vector and smear
-  double params_[5];
-  for (int i = 0; i < 5; ++i) {
-    double val = 0.;
-    for (int j = 0; j < 5; ++j)
-      val += lutEntry->eigvec[j][i] * o2track.getParam(j);
-    params_[i] = gRandom->Gaus(val, sqrt(lutEntry->eigval[i]));
-  }  
-  // transform back params vector
-  for (int i = 0; i < 5; ++i) {
-    double val = 0.;
-    for (int j = 0; j < 5; ++j)
-      val += lutEntry->eiginv[j][i] * params_[j];
-    o2track.setParam(val, i);
+  if (mSmearingMethod == kCholesky) {
+    // correlated smearing with the lower-triangular factor
+    double gaus_[5];
+    for (int i = 0; i < 5; ++i)
+      gaus_[i] = gRandom->Gaus();
+    for (int i = 0, k = 0; i < 5; ++i) {
+      double val = o2track.getParam(i);
+      for (int j = 0; j < i + 1; ++j, ++k)
+        val += lutEntry->chol[k] * gaus_[j];
+      o2track.setParam(val, i);
+    }
+  } else {
+    // transform params vector and smear
+    double params_[5];
+    for (int i = 0; i < 5; ++i) {
+      double val = 0.;
+      for (int j = 0; j < 5; ++j)
+        val += lutEntry->eigvec[j][i] * o2track.getParam(j);
+      params_[i] = gRandom->Gaus(val, sqrt(lutEntry->eigval[i]));
+    }
+    // transform back params vector
+    for (int i = 0; i < 5; ++i) {
+      double val = 0.;
+      for (int j = 0; j < 5; ++j)
+        val += lutEntry->eiginv[j][i] * params_[j];
+      o2track.setParam(val, i);
+    }
   }
   // should make a sanity check that par[2] sin(phi) is in [-1, 1]
   if (fabs(o2track.getParam(2)) > 1.) {
@@ -132,15 +834,35 @@ TrackSmearer::smearTrack(O2Track &o2track, lutEntry_t *lutEntry)
 
 bool
 TrackSmearer::smearTrack(O2Track &o2track, int pid, float nch)
+{
+  return smearTrack(o2track, pid, nch, 0.);
+}
+
+/*****************************************************************/
+
+bool
+TrackSmearer::smearTrack(O2Track &o2track, int pid, float nch, float radius)
 {
 
-  auto pt = o2track.getPt();
-  if (abs(pid) == 1000020030) {
-    pt *= 2.f;
+  auto &species = getSpecies(pid);
+  if (species.fallback) mFallbackCount[abs(pid)]++;
+  if (species.slot < 0 || !mLUTHeader[species.slot]) return false;
+  auto pt = o2track.getPt() * species.charge;
+  // species tables may only cover where the mass scaling breaks, the universal LUT does the rest
+  auto ipdg = species.slot;
+  auto iuniversal = getUniversalSlot();
+  if (iuniversal >= 0 && !mLUTHeader[ipdg]->ptmap.contains(pt)) ipdg = iuniversal;
+  // a particle of mass m and charge z behaves as a unit-charge particle of mass m/z at the same beta-gamma
+  auto lutHeader = mLUTHeader[ipdg];
+  float covScale = 1.;
+  if (ipdg == iuniversal || species.scaled) {
+    covScale = species.charge * lutHeader->mass / species.mass;
+    pt = ipdg == iuniversal ? pt / species.mass : pt * lutHeader->mass / species.mass;
   }
   auto eta = o2track.getEta();
-  auto lutEntry = getLUTEntry(pid, nch, 0., eta, pt);
+  auto lutEntry = mUseInterpolation ? getInterpolatedLUTEntryAt(ipdg, nch, radius, eta, pt) : getLUTEntryAt(ipdg, nch, radius, eta, pt);
   if (!lutEntry || !lutEntry->valid) return false;
+  if (covScale != 1.) lutEntry = scaleLUTEntry(lutEntry, covScale);
   return smearTrack(o2track, lutEntry);
 }
   
@@ -154,7 +876,8 @@ TrackSmearer::smearTrack(Track &track, bool atDCA)
   TrackUtils::convertTrackToO2Track(track, o2track, atDCA);
   int pdg = track.PID;
   float nch = mdNdEta; // use locally stored dNch/deta for the time being
-  if (!smearTrack(o2track, pdg, nch)) return false;
+  float radius = 0.1 * std::hypot(track.X, track.Y); // production vertex [cm]
+  if (!smearTrack(o2track, pdg, nch, radius)) return false;
   TrackUtils::convertO2TrackToTrack(o2track, track, atDCA);
   return true;
   
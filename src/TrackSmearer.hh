@@ -7,7 +7,13 @@
 #include "ReconstructionDataFormats/Track.h"
 #include "classes/DelphesClasses.h"
 #include "lutCovm.hh"
+#include <fstream>
+#include <functional>
 #include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 using O2Track = o2::track::TrackParCov;
 
@@ -19,43 +25,90 @@ namespace delphes
 class TrackSmearer {
   
 public:
+  enum ESmearingMethod { kEigen, kCholesky };
+  enum EFallback { kFallbackReject, kFallbackNearestMass, kFallbackScaledPion };
+  // fills the entry of a LUT bin, given by its (nch, radius, eta, pt) indices
+  using lutSolver_t = std::function<bool(lutEntry_t &lutEntry, const lutHeader_t &lutHeader, int inch, int irad, int ieta, int ipt)>;
+
   TrackSmearer() = default;
   ~TrackSmearer() = default;
 
   /** LUT methods **/
   bool loadTable(int pdg, const char *filename, bool forceReload = false);
+  bool loadTableFamily(int pdg, const std::map<float, std::string> &filenames, bool forceReload = false);
+  bool setTableSolver(int pdg, const lutHeader_t &lutHeader, lutSolver_t solver, const char *filename = nullptr, bool forceReload = false);
+  void setBz(float val);
   void useEfficiency(bool val) { mUseEfficiency = val; };
   void setWhatEfficiency(int val) { mWhatEfficiency = val; };
-  lutHeader_t *getLUTHeader(int pdg) { return mLUTHeader[getIndexPDG(pdg)]; };
+  void useInterpolation(bool val) { mUseInterpolation = val; };
+  void setSmearingMethod(int val) { mSmearingMethod = val; };
+  void setFallback(int val) { mFallback = val; mFallbackLink.clear(); };
+  void setSpecies(int pdg, float mass, float charge); // species unknown to TDatabasePDG, or overriding it
+  lutHeader_t *getLUTHeader(int pdg) { auto ipdg = getIndexPDG(pdg); return ipdg < 0 ? nullptr : mLUTHeader[ipdg]; };
   lutEntry_t *getLUTEntry(int pdg, float nch, float radius, float eta, float pt);
+  lutEntry_t *getInterpolatedLUTEntry(int pdg, float nch, float radius, float eta, float pt);
 
   bool smearTrack(O2Track &o2track, lutEntry_t *lutEntry);
   bool smearTrack(O2Track &o2track, int pid, float nch);
+  bool smearTrack(O2Track &o2track, int pid, float nch, float radius);
   bool smearTrack(Track &track, bool atDCA = true);
 
-  int getIndexPDG(int pdg) {
-    switch(abs(pdg)) {
-    case 11: return 0; // Electron
-    case 13: return 1; // Muon
-    case 211: return 2; // Pion
-    case 321: return 3; // Kaon
-    case 2212: return 4; // Proton
-    case 1000010020: return 5; // Deuteron
-    case 1000010030: return 6; // Triton
-    case 1000020030: return 7; // Helium3
-    default: return 2; // Default: pion
-    };
-  };
+  int getIndexPDG(int pdg) { return getSpecies(pdg).slot; };
+  int getNumberOfSpecies() const { return mLUTHeader.size(); };
+  long getNumberOfFallbacks() const;
+  void printFallbacks() const;
 
   void setdNdEta(float val) { mdNdEta = val; };
   
 protected:
-  static constexpr unsigned int nLUTs = 8; // Number of LUT available
-  lutHeader_t *mLUTHeader[nLUTs] = {nullptr};
-  lutEntry_t *****mLUTEntry[nLUTs] = {nullptr};
+  struct speciesLink_t {
+    int slot = -1;          // LUT slot, -1 if rejected
+    float mass = 0.;        // particle mass
+    float charge = 1.;      // particle |charge|, the track pt is pt over charge
+    bool scaled = false;    // look up the LUT at the same beta-gamma
+    bool fallback = false;  // not a registered species
+  };
+  const speciesLink_t &getSpecies(int pdg);
+  bool findMassCharge(int pdg, float &mass, float &charge) const;
+  int prepareSlot(int pdg, bool forceReload);
+  bool readTable(int pdg, const char *filename, lutHeader_t *&lutHeader, lutEntry_t *****&lutEntry);
+  static void deleteTable(lutHeader_t *&lutHeader, lutEntry_t *****&lutEntry);
+  void registerTable(int pdg, int ipdg);
+  void releaseSlot(int pdg, int ipdg);
+  bool halveTable(int ipdg);
+  lutEntry_t *getEntry(int ipdg, int inch, int irad, int ieta, int ipt);
+  lutEntry_t *solveEntry(int ipdg, int inch, int irad, int ieta, int ipt);
+  int readSolved(int ipdg, const char *filename);
+  bool checkField(const lutHeader_t *lutHeader) const;
+  lutEntry_t *getLUTEntryAt(int ipdg, float nch, float radius, float eta, float pt);
+  lutEntry_t *getInterpolatedLUTEntryAt(int ipdg, float nch, float radius, float eta, float pt);
+  lutEntry_t *scaleLUTEntry(const lutEntry_t *lutEntry, float covScale);
+  int getUniversalSlot() const;
+  static void diagonalise(const float *covm, float eigvec[5][5]);
+  static void decompose(lutEntry_t &lutEntry);
+  lutEntry_t *getInterpolationCell(int ipdg, int inch, int irad, int ieta, int ipt);
+
+  std::vector<lutHeader_t *> mLUTHeader;                 //! LUT header per slot
+  std::vector<lutEntry_t *****> mLUTEntry;               //! LUT entries per slot
+  std::vector<bool> mEtaMirrored;                        //! only eta >= 0 stored per slot
+  std::vector<lutSolver_t> mSolver;                      //! solver of the missing bins per slot
+  std::vector<std::shared_ptr<std::ofstream>> mSolvedFile; //! solved bins are appended here per slot
+  std::unordered_map<int, speciesLink_t> mPDGToSlot;    //! registered species, by |pdg|
+  std::unordered_map<int, speciesLink_t> mFallbackLink; //! resolved fallbacks, by |pdg|
+  std::unordered_map<int, std::pair<float, float>> mMassCharge; //! mass and |charge| set by the user, by |pdg|
+  std::map<int, long> mFallbackCount;                   //! tracks using a fallback, by |pdg|
+  int mFallback = kFallbackNearestMass;
   bool mUseEfficiency = true;
   int mWhatEfficiency = 1;
   float mdNdEta =  1600.;
+  float mBz = 0.;         // runtime field [T], 0 if not set
+  int mSmearingMethod = kCholesky;
+
+  bool mUseInterpolation = false;
+  std::vector<std::map<int, lutEntry_t>> mInterpolationCell; //! eigenbasis cache per interpolation cell
+  lutEntry_t mInterpolatedEntry;
+  lutEntry_t mScaledEntry;
+  lutEntry_t mMirroredEntry;
   
 };
   
@@ -4,6 +4,7 @@
 #include "TrackUtils.hh"
 #include "TParticle.h"
 #include "TParticlePDG.h"
+#include <cmath>
 
 namespace o2
 {
@@ -189,6 +190,68 @@ TrackUtils::propagateToDCA(O2Track &o2track, std::array<float, 3> xyz, float Bz)
 
 /*****************************************************************/
 
+float
+TrackUtils::invariantMass(const std::array<float, 3> &p1, float m1, const std::array<float, 3> &p2, float m2)
+{
+  float e = std::sqrt(p1[0] * p1[0] + p1[1] * p1[1] + p1[2] * p1[2] + m1 * m1) +
+    std::sqrt(p2[0] * p2[0] + p2[1] * p2[1] + p2[2] * p2[2] + m2 * m2);
+  float px = p1[0] + p2[0], py = p1[1] + p2[1], pz = p1[2] + p2[2];
+  return std::sqrt(std::max(0.f, e * e - px * px - py * py - pz * pz));
+}
+
+/*****************************************************************/
+
+float
+TrackUtils::invariantMass(const std::array<float, 3> &p1, float m1, const std::array<float, 3> &p2, float m2, const std::array<float, 3> &p3, float m3)
+{
+  float e = std::sqrt(p1[0] * p1[0] + p1[1] * p1[1] + p1[2] * p1[2] + m1 * m1) +
+    std::sqrt(p2[0] * p2[0] + p2[1] * p2[1] + p2[2] * p2[2] + m2 * m2) +
+    std::sqrt(p3[0] * p3[0] + p3[1] * p3[1] + p3[2] * p3[2] + m3 * m3);
+  float px = p1[0] + p2[0] + p3[0], py = p1[1] + p2[1] + p3[1], pz = p1[2] + p2[2] + p3[2];
+  return std::sqrt(std::max(0.f, e * e - px * px - py * py - pz * pz));
+}
+
+/*****************************************************************/
+
+int
+EtaPhiCells::findCell(float eta, float phi) const
+{
+  int ieta = (int)((eta + mEtaMax) / (2. * mEtaMax) * mNEta);
+  ieta = std::min(std::max(ieta, 0), mNEta - 1);
+  int iphi = (int)(phi / (2. * M_PI) * mNPhi) % mNPhi;
+  if (iphi < 0) iphi += mNPhi;
+  return ieta * mNPhi + iphi;
+}
+
+/*****************************************************************/
+
+bool
+EtaPhiCells::areNeighbours(int cell1, int cell2) const
+{
+  int deta = std::abs(cell1 / mNPhi - cell2 / mNPhi);
+  int dphi = std::abs(cell1 % mNPhi - cell2 % mNPhi);
+  return deta <= 1 && std::min(dphi, mNPhi - dphi) <= 1;
+}
+
+/*****************************************************************/
+
+void
+EtaPhiCells::fill(const std::vector<int> &cells)
+{
+  const int nCells = mNEta * mNPhi;
+  mCellStart.assign(nCells + 1, 0);
+  for (auto cell : cells)
+    if (cell >= 0) mCellStart[cell + 1]++;
+  for (int j = 0; j < nCells; ++j)
+    mCellStart[j + 1] += mCellStart[j];
+  mCellIndex.resize(mCellStart[nCells]);
+  std::vector<int> next(mCellStart.begin(), mCellStart.end() - 1);
+  for (int i = 0; i < (int)cells.size(); ++i)
+    if (cells[i] >= 0) mCellIndex[next[cells[i]]++] = i;
+}
+
+/*****************************************************************/
+
   
 } /** namespace delphes **/
 } /** namespace o2 **/
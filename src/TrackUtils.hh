@@ -6,6 +6,9 @@
 
 #include "ReconstructionDataFormats/Track.h"
 #include "classes/DelphesClasses.h"
+#include <algorithm>
+#include <array>
+#include <vector>
 
 using O2Track = o2::track::TrackParCov;
 
@@ -28,10 +31,57 @@ public:
   static void convertTParticleToO2Track(const TParticle &particle, O2Track &o2track);
 
   static bool propagateToDCA(O2Track &o2track, std::array<float, 3> xyz, float Bz);
+
+  static constexpr float kMassPion = 0.13957;   // [GeV/c2]
+  static constexpr float kMassKaon = 0.493677;  // [GeV/c2]
+  static constexpr float kMassProton = 0.938272; // [GeV/c2]
+  static float invariantMass(const std::array<float, 3> &p1, float m1, const std::array<float, 3> &p2, float m2);
+  static float invariantMass(const std::array<float, 3> &p1, float m1, const std::array<float, 3> &p2, float m2, const std::array<float, 3> &p3, float m3);
   
 protected:
   
 };
+
+/// eta-phi cells of the secondary vertex finders: tracks are bucketed by
+/// cell with a counting sort and combined only with the ones in the cells
+/// around theirs, phi wraps around
+
+class EtaPhiCells {
+
+public:
+  void setCells(int nEta, int nPhi, float etaMax) { mNEta = nEta; mNPhi = nPhi; mEtaMax = etaMax; };
+
+  int findCell(float eta, float phi) const;
+  bool areNeighbours(int cell1, int cell2) const;
+
+  // buckets the entries by their cell, entries with a negative cell are left out
+  void fill(const std::vector<int> &cells);
+  // calls f(entry) for the entries in the cell and in the ones around it
+  template <typename F>
+  void forNeighbours(int cell, F &&f) const;
+
+protected:
+  int mNEta = 10;
+  int mNPhi = 18;
+  float mEtaMax = 4.;
+
+  std::vector<int> mCellStart; // entries of cell i are mCellIndex[mCellStart[i], mCellStart[i + 1])
+  std::vector<int> mCellIndex;
+};
+
+template <typename F>
+void
+EtaPhiCells::forNeighbours(int cell, F &&f) const
+{
+  int ieta = cell / mNPhi, iphi = cell % mNPhi;
+  for (int jeta = std::max(ieta - 1, 0); jeta <= std::min(ieta + 1, mNEta - 1); ++jeta) {
+    for (int k = 0; k < std::min(3, mNPhi); ++k) {
+      int jcell = jeta * mNPhi + (mNPhi < 3 ? k : (iphi + k - 1 + mNPhi) % mNPhi);
+      for (int i = mCellStart[jcell]; i < mCellStart[jcell + 1]; ++i)
+        f(mCellIndex[i]);
+    }
+  }
+}
   
 } /** namespace delphes **/
 } /** namespace o2 **/
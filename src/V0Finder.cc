@@ -0,0 +1,148 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "V0Finder.hh"
+#include "TrackUtils.hh"
+#include <algorithm>
+#include <cmath>
+
+namespace o2
+{
+namespace delphes
+{
+
+namespace
+{
+constexpr float kMassLambda = 1.115683;
+} // namespace
+
+/*****************************************************************/
+
+void
+V0Finder::setup(float bz)
+{
+  mBz = bz;
+  mFitter.setup(bz);
+}
+
+/*****************************************************************/
+
+void
+V0Finder::clear()
+{
+  mTracks.clear();
+  mCandidates.clear();
+  mV0s.clear();
+  mCascades.clear();
+}
+
+/*****************************************************************/
+
+void
+V0Finder::addTrack(const O2Track &o2track, int index)
+{
+  if (o2track.getCharge() == 0) return;
+  mTracks.push_back({o2track, index});
+}
+
+/*****************************************************************/
+
+float
+V0Finder::cosPA(const Vertex &vertex, const O2Track &parent, std::array<float, 3> pv) const
+{
+  std::array<float, 3> p;
+  parent.getPxPyPzGlo(p);
+  float dx = vertex.x - pv[0], dy = vertex.y - pv[1], dz = vertex.z - pv[2];
+  float norm = std::sqrt((dx * dx + dy * dy + dz * dz) * (p[0] * p[0] + p[1] * p[1] + p[2] * p[2]));
+  if (!(norm > 0.)) return -1.;
+  return (dx * p[0] + dy * p[1] + dz * p[2]) / norm;
+}
+
+/*****************************************************************/
+
+int
+V0Finder::process(std::array<float, 3> pv)
+{
+  mCandidates.clear();
+  mV0s.clear();
+  mCascades.clear();
+
+  // preselection: daughters and bachelors do not point to the primary vertex
+  for (auto &t : mTracks) {
+    O2Track dca = t.track;
+    if (!TrackUtils::propagateToDCA(dca, pv, mBz)) continue;
+    auto xyz = dca.getXYZGlo();
+    if (std::hypot(xyz.X() - pv[0], xyz.Y() - pv[1]) < mMinDCAToPV) continue;
+    mCandidates.push_back(t);
+  }
+
+  // bucket the candidates by charge and eta-phi cell
+  const int nCandidates = mCandidates.size();
+  std::vector<int> cell(nCandidates), charge(nCandidates);
+  for (int i = 0; i < nCandidates; ++i) {
+    auto &track = mCandidates[i].track;
+    cell[i] = mCells[0].findCell(track.getEta(), track.getPhi());
+    charge[i] = track.getCharge() > 0 ? 0 : 1;
+  }
+  for (int ic = 0; ic < 2; ++ic) {
+    std::vector<int> cells(nCandidates, -1);
+    for (int i = 0; i < nCandidates; ++i)
+      if (charge[i] == ic) cells[i] = cell[i];
+    mCells[ic].fill(cells);
+  }
+
+  // V0s: positive candidates with the negative ones around them
+  for (int ipos = 0; ipos < nCandidates; ++ipos) {
+    if (charge[ipos] != 0) continue;
+    mCells[1].forNeighbours(cell[ipos], [&](int ineg) {
+      V0 v0;
+      if (!mFitter.fitVertex(mCandidates[ipos].track, mCandidates[ineg].track, v0.vertex, v0.parent)) return;
+      v0.dca = mFitter.getDCA();
+      if (v0.dca > mMaxDCADaughters) return;
+      float radius = std::hypot(v0.vertex.x, v0.vertex.y);
+      if (radius < mMinRadius || radius > mMaxRadius) return;
+      v0.cosPA = cosPA(v0.vertex, v0.parent, pv);
+      if (v0.cosPA < mMinCosPA) return;
+      std::array<float, 3> ppos, pneg;
+      mFitter.getTrack(0).getPxPyPzGlo(ppos);
+      mFitter.getTrack(1).getPxPyPzGlo(pneg);
+      v0.mLambda = TrackUtils::invariantMass(ppos, TrackUtils::kMassProton, pneg, TrackUtils::kMassPion);
+      v0.mAntiLambda = TrackUtils::invariantMass(ppos, TrackUtils::kMassPion, pneg, TrackUtils::kMassProton);
+      v0.pos = mCandidates[ipos].index;
+      v0.neg = mCandidates[ineg].index;
+      mV0s.push_back(v0);
+    });
+  }
+
+  // cascades: Lambda with a negative bachelor, anti-Lambda with a positive one
+  for (int iv0 = 0; iv0 < (int)mV0s.size(); ++iv0) {
+    auto &v0 = mV0s[iv0];
+    int v0cell = mCells[0].findCell(v0.parent.getEta(), v0.parent.getPhi());
+    for (int ic = 0; ic < 2; ++ic) {
+      float mass = ic == 1 ? v0.mLambda : v0.mAntiLambda;
+      if (std::abs(mass - kMassLambda) > mLambdaMassWindow) continue;
+      mCells[ic].forNeighbours(v0cell, [&](int ibach) {
+        auto &bachelor = mCandidates[ibach];
+        if (bachelor.index == v0.pos || bachelor.index == v0.neg) return;
+        Cascade cascade;
+        O2Track parent;
+        if (!mFitter.fitVertex(v0.parent, bachelor.track, cascade.vertex, parent)) return;
+        cascade.dca = mFitter.getDCA();
+        if (cascade.dca > mMaxDCACascade) return;
+        if (std::hypot(cascade.vertex.x, cascade.vertex.y) < mMinRadius) return;
+        cascade.cosPA = cosPA(cascade.vertex, parent, pv);
+        if (cascade.cosPA < mMinCascadeCosPA) return;
+        cascade.v0 = iv0;
+        cascade.bachelor = bachelor.index;
+        mCascades.push_back(cascade);
+      });
+    }
+  }
+
+  return mV0s.size();
+}
+
+/*****************************************************************/
+
+} /** namespace delphes **/
+} /** namespace o2 **/
@@ -0,0 +1,94 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _DelphesO2_V0Finder_h_
+#define _DelphesO2_V0Finder_h_
+
+#include "VertexFitter.hh"
+#include "TrackUtils.hh"
+#include <array>
+#include <vector>
+
+namespace o2
+{
+namespace delphes
+{
+
+/// V0 and cascade finder on the smeared tracks of one collision.
+/// Tracks displaced from the primary vertex are bucketed by charge and
+/// eta-phi cell, pairs and bachelors are only looked for in the
+/// neighbouring cells and fitted with the DCAFitterN of VertexFitter
+
+class V0Finder {
+
+public:
+  V0Finder() = default;
+  ~V0Finder() = default;
+
+  struct V0 {
+    int pos, neg;      // track indices, as given to addTrack
+    Vertex vertex;     // [cm]
+    O2Track parent;    // neutral track at the V0 vertex
+    float dca;         // between the daughters [cm]
+    float cosPA;
+    float mLambda, mAntiLambda;
+  };
+
+  struct Cascade {
+    int v0;            // index in getV0s()
+    int bachelor;      // track index, as given to addTrack
+    Vertex vertex;     // [cm]
+    float dca;
+    float cosPA;
+  };
+
+  void setup(float bz); // [T]
+  void setCells(int nEta, int nPhi, float etaMax) { for (auto &cells : mCells) cells.setCells(nEta, nPhi, etaMax); };
+
+  void setMinDCAToPV(float val) { mMinDCAToPV = val; };
+  void setMaxDCADaughters(float val) { mMaxDCADaughters = val; };
+  void setMinCosPA(float val) { mMinCosPA = val; };
+  void setRadius(float min, float max) { mMinRadius = min; mMaxRadius = max; };
+  void setLambdaMassWindow(float val) { mLambdaMassWindow = val; };
+  void setMaxDCACascade(float val) { mMaxDCACascade = val; };
+  void setMinCascadeCosPA(float val) { mMinCascadeCosPA = val; };
+
+  void clear();
+  void addTrack(const O2Track &o2track, int index);
+  int process(std::array<float, 3> pv);
+
+  const std::vector<V0> &getV0s() const { return mV0s; };
+  const std::vector<Cascade> &getCascades() const { return mCascades; };
+
+protected:
+
+  struct Candidate {
+    O2Track track;
+    int index;
+  };
+
+  float cosPA(const Vertex &vertex, const O2Track &parent, std::array<float, 3> pv) const;
+
+  VertexFitter mFitter;
+  float mBz = 0.5; // [T]
+
+  float mMinDCAToPV = 0.01;       // [cm]
+  float mMaxDCADaughters = 0.1;   // [cm]
+  float mMinCosPA = 0.99;
+  float mMinRadius = 0.05;        // [cm]
+  float mMaxRadius = 100.;        // [cm]
+  float mLambdaMassWindow = 0.01; // [GeV/c2]
+  float mMaxDCACascade = 0.1;     // [cm]
+  float mMinCascadeCosPA = 0.99;
+
+  std::vector<Candidate> mTracks;
+  std::vector<Candidate> mCandidates;
+  EtaPhiCells mCells[2]; // candidates per charge
+  std::vector<V0> mV0s;
+  std::vector<Cascade> mCascades;
+};
+
+} /** namespace delphes **/
+} /** namespace o2 **/
+
+#endif /** _DelphesO2_V0Finder_h_ **/
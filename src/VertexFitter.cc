@@ -18,6 +18,10 @@ VertexFitter::setup(float bz, bool useAbsDCA, bool propagateToVtx)
   mFitter.setUseAbsDCA(useAbsDCA); // to use abs distance minimization
   mFitter.setPropagateToPCA(propagateToVtx); // to propagate tracks to closest distance to the found vertex
   mFitter.setMaxDistance2ToMerge(0.01);
+  mFitter3.setBz(bz * 10.);
+  mFitter3.setUseAbsDCA(useAbsDCA);
+  mFitter3.setPropagateToPCA(propagateToVtx);
+  mFitter3.setMaxDistance2ToMerge(0.01);
 }
 
 /*****************************************************************/
@@ -36,6 +40,54 @@ VertexFitter::fitVertex(O2Track& o2track1, O2Track& o2track2, Vertex& vertex)
 
 /*****************************************************************/
 
+bool
+VertexFitter::fitVertex(O2Track& o2track1, O2Track& o2track2, Vertex& vertex, O2Track& parent)
+{
+  // also returns the track of the decayed particle, starting at the vertex
+  if (!fitVertex(o2track1, o2track2, vertex)) return false;
+  parent = mFitter.createParentTrackParCov(0);
+  return true;
+}
+
+/*****************************************************************/
+
+float
+VertexFitter::getDCA()
+{
+  // distance of the two tracks propagated to the PCA, the chi2 of the absolute DCA
+  // minimisation is the sum of their squared distances to the PCA, not their distance
+  auto xyz1 = mFitter.getTrack(0).getXYZGlo();
+  auto xyz2 = mFitter.getTrack(1).getXYZGlo();
+  float dx = xyz1.X() - xyz2.X(), dy = xyz1.Y() - xyz2.Y(), dz = xyz1.Z() - xyz2.Z();
+  return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/*****************************************************************/
+
+bool
+VertexFitter::fitVertex(O2Track& o2track1, O2Track& o2track2, O2Track& o2track3, Vertex& vertex)
+{
+  int nv = mFitter3.process(o2track1, o2track2, o2track3);
+  if (!nv) return false;
+  const auto& fittedVertex = mFitter3.getPCACandidate(0);
+  vertex.x = fittedVertex[0];
+  vertex.y = fittedVertex[1];
+  vertex.z = fittedVertex[2];
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+VertexFitter::fitVertex(O2Track& o2track1, O2Track& o2track2, O2Track& o2track3, Vertex& vertex, O2Track& parent)
+{
+  if (!fitVertex(o2track1, o2track2, o2track3, vertex)) return false;
+  parent = mFitter3.createParentTrackParCov(0);
+  return true;
+}
+
+/*****************************************************************/
+
 bool
 VertexFitter::fitVertex(Track& track1, Track& track2, Vertex& vertex)
 {
@@ -28,10 +28,21 @@ public:
   void setup(float bz, bool useAbsDCA = true, bool propagateToVtx = true);
   bool fitVertex(O2Track &o2track1, O2Track &o2track2, Vertex &vertex);
   bool fitVertex(Track &track1, Track &track2, Vertex &vertex);
+  bool fitVertex(O2Track &o2track1, O2Track &o2track2, Vertex &vertex, O2Track &parent);
+
+  float getDCA(); // between the tracks of the last fit, at the PCA [cm]
+  O2Track &getTrack(int i) { return mFitter.getTrack(i); }; // propagated to the last vertex
+
+  // three-prong decays, with their own fitter
+  bool fitVertex(O2Track &o2track1, O2Track &o2track2, O2Track &o2track3, Vertex &vertex);
+  bool fitVertex(O2Track &o2track1, O2Track &o2track2, O2Track &o2track3, Vertex &vertex, O2Track &parent);
+  float getChi2Prong3() const { return mFitter3.getChi2AtPCACandidate(); };
+  O2Track &getTrackProng3(int i) { return mFitter3.getTrack(i); };
 
 protected:
 
   o2::vertexing::DCAFitterN<2> mFitter;
+  o2::vertexing::DCAFitterN<3> mFitter3;
 };
   
 } /** namespace delphes **/
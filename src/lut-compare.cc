@@ -0,0 +1,171 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/// compares two LUTs with the same binning entry by entry, e.g. the same
+/// geometry written by two versions of the solver: the track parameter
+/// resolutions, their correlations and the efficiency and good hit
+/// probabilities, reported per barrel and forward eta range
+
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "lutCovm.hh"
+
+#define LUTCOVM_VERSION_NOCHOL 20210801 // entries without the Cholesky factor
+
+bool
+readLUT(const std::string &filename, lutHeader_t &lutHeader, std::vector<lutEntry_t> &lutTable)
+{
+  std::ifstream lutFile(filename, std::ifstream::binary);
+  if (!lutFile.is_open()) {
+    std::cout << " --- cannot open LUT file: " << filename << std::endl;
+    return false;
+  }
+  lutFile.read(reinterpret_cast<char *>(&lutHeader), sizeof(lutHeader));
+  if (lutFile.gcount() != sizeof(lutHeader)) {
+    std::cout << " --- troubles reading header of LUT file: " << filename << std::endl;
+    return false;
+  }
+  // the Cholesky factor is the last member, the older entries are read up to it
+  size_t entrySize;
+  if (lutHeader.version == LUTCOVM_VERSION) entrySize = sizeof(lutEntry_t);
+  else if (lutHeader.version == LUTCOVM_VERSION_NOCHOL) entrySize = offsetof(lutEntry_t, chol);
+  else {
+    std::cout << " --- unknown LUT header version " << lutHeader.version << ": " << filename << std::endl;
+    return false;
+  }
+  const size_t nbins = (size_t)lutHeader.nchmap.nbins * lutHeader.radmap.nbins * lutHeader.etamap.nbins * lutHeader.ptmap.nbins;
+  lutTable.resize(nbins);
+  for (auto &entry : lutTable) {
+    lutFile.read(reinterpret_cast<char *>(&entry), entrySize);
+    if ((size_t)lutFile.gcount() != entrySize) {
+      std::cout << " --- troubles reading covariance matrix entry from LUT file: " << filename << std::endl;
+      return false;
+    }
+  }
+  if (lutFile.peek() != EOF) {
+    std::cout << " --- LUT file " << filename << " has more entries than its bins" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+
+  std::string refFile, testFile;
+  float etaMaxBarrel, tolerance;
+
+  /** process arguments **/
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  po::positional_options_description pos;
+  pos.add("reference", 1);
+  pos.add("test", 1);
+  try {
+    desc.add_options()
+      ("help,h", "Print help messages")
+      ("reference,r", po::value<std::string>(&refFile), "Reference LUT file")
+      ("test,t", po::value<std::string>(&testFile), "LUT file to compare with the reference")
+      ("eta-barrel,e", po::value<float>(&etaMaxBarrel)->default_value(1.75), "Eta range of the barrel, the rest is reported as forward")
+      ("tolerance,T", po::value<float>(&tolerance)->default_value(1.e-3), "Largest relative difference of the resolutions and absolute difference of the correlations and probabilities");
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+      std::cout << "Usage: lut-compare reference.dat test.dat" << std::endl;
+      std::cout << desc << std::endl;
+      return 0;
+    }
+    if (refFile.empty() || testFile.empty()) {
+      std::cout << "Usage: lut-compare reference.dat test.dat" << std::endl;
+      std::cout << desc << std::endl;
+      return 1;
+    }
+  } catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  lutHeader_t refHeader, testHeader;
+  std::vector<lutEntry_t> refTable, testTable;
+  if (!readLUT(refFile, refHeader, refTable) || !readLUT(testFile, testHeader, testTable)) return 1;
+  if (refHeader.pdg != testHeader.pdg || refHeader.mass != testHeader.mass || refHeader.field != testHeader.field ||
+      !(refHeader.nchmap == testHeader.nchmap && refHeader.radmap == testHeader.radmap &&
+        refHeader.etamap == testHeader.etamap && refHeader.ptmap == testHeader.ptmap)) {
+    std::cout << " --- LUT headers differ, the entries cannot be compared" << std::endl;
+    refHeader.print();
+    testHeader.print();
+    return 1;
+  }
+  refHeader.print();
+
+  // largest difference and number of entries beyond the tolerance, per quantity and eta range
+  enum { kSigma, kCorrelation, kEfficiency, kGoodHit, kNQuantities };
+  const char *quantityName[kNQuantities] = {"sigma (relative)", "correlation", "efficiency", "good hit prob."};
+  const char *rangeName[2] = {"barrel", "forward"};
+  double maxDiff[2][kNQuantities] = {{0.}};
+  long nDiff[2][kNQuantities] = {{0}}, nCompared[2] = {0}, nValidity[2] = {0};
+  auto compare = [&](int range, int quantity, double diff) {
+    diff = std::abs(diff);
+    if (diff > maxDiff[range][quantity]) maxDiff[range][quantity] = diff;
+    if (diff > tolerance) nDiff[range][quantity]++;
+  };
+
+  const int neta = refHeader.etamap.nbins;
+  const int npt = refHeader.ptmap.nbins;
+  for (size_t ibin = 0; ibin < refTable.size(); ++ibin) {
+    const auto &ref = refTable[ibin];
+    const auto &test = testTable[ibin];
+    const int range = std::abs(refHeader.etamap.eval((ibin / npt) % neta)) > etaMaxBarrel;
+    if (ref.valid != test.valid) {
+      nValidity[range]++;
+      continue;
+    }
+    if (!ref.valid) continue;
+    nCompared[range]++;
+    double refSigma[5], testSigma[5];
+    for (int i = 0; i < 5; ++i) {
+      refSigma[i] = std::sqrt(std::max(ref.covm[i * (i + 3) / 2], 0.f));
+      testSigma[i] = std::sqrt(std::max(test.covm[i * (i + 3) / 2], 0.f));
+      if (refSigma[i] > 0.) compare(range, kSigma, testSigma[i] / refSigma[i] - 1.);
+      else compare(range, kSigma, testSigma[i] > 0. ? 1. : 0.);
+    }
+    for (int i = 1, k = 1; i < 5; ++i, ++k)
+      for (int j = 0; j < i; ++j, ++k) {
+        if (!(refSigma[i] > 0. && refSigma[j] > 0. && testSigma[i] > 0. && testSigma[j] > 0.)) continue;
+        compare(range, kCorrelation, test.covm[k] / testSigma[i] / testSigma[j] - ref.covm[k] / refSigma[i] / refSigma[j]);
+      }
+    compare(range, kEfficiency, test.eff - ref.eff);
+    compare(range, kEfficiency, test.eff2 - ref.eff2);
+    compare(range, kGoodHit, test.itof - ref.itof);
+    compare(range, kGoodHit, test.otof - ref.otof);
+  }
+
+  long nFailed = 0;
+  for (int range = 0; range < 2; ++range) {
+    printf(" --- %s: %ld entries compared, %ld with different validity \n", rangeName[range], nCompared[range], nValidity[range]);
+    for (int quantity = 0; quantity < kNQuantities; ++quantity) {
+      printf("     %-18s max. difference = %e, %ld beyond %e \n", quantityName[quantity], maxDiff[range][quantity], nDiff[range][quantity], tolerance);
+      nFailed += nDiff[range][quantity];
+    }
+    nFailed += nValidity[range];
+  }
+  if (nFailed > 0) {
+    std::cout << " --- the LUTs differ beyond the tolerance" << std::endl;
+    return 1;
+  }
+  std::cout << " --- the LUTs agree within the tolerance" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,154 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/// merges the LUT shards written by lutWrite with a partial nch/eta range
+/// into a complete table, after checking that their headers are identical
+/// and that they cover every (nch, eta) bin exactly once
+
+#include <boost/program_options.hpp>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "lutCovm.hh"
+
+int main(int argc, char** argv)
+{
+
+  std::string outFile;
+  std::vector<std::string> inFiles;
+
+  /** process arguments **/
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  po::positional_options_description pos;
+  pos.add("input", -1);
+  try {
+    desc.add_options()
+      ("help,h", "Print help messages")
+      ("output,o", po::value<std::string>(&outFile)->default_value("lutCovm.dat"), "Output LUT file")
+      ("input,i", po::value<std::vector<std::string>>(&inFiles)->multitoken(), "LUT shard files to merge");
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help") || inFiles.empty()) {
+      std::cout << "Usage: lut-merge -o lutCovm.dat shard0.dat shard1.dat ..." << std::endl;
+      std::cout << desc << std::endl;
+      return 1;
+    }
+  } catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  lutHeader_t lutHeader;
+  int nnch = 0, nrad = 0, neta = 0, npt = 0;
+  std::vector<lutEntry_t> lutTable;
+  std::vector<int> lutOwner; // shard filling each (nch, eta) bin, -1 if none yet
+
+  for (int ifile = 0; ifile < (int)inFiles.size(); ++ifile) {
+    const auto &inFile = inFiles[ifile];
+    std::cout << " --- reading LUT shard: " << inFile << std::endl;
+    std::ifstream lutFile(inFile, std::ifstream::binary);
+    if (!lutFile.is_open()) {
+      std::cout << " --- cannot open LUT shard: " << inFile << std::endl;
+      return 1;
+    }
+
+    lutHeader_t shardHeader;
+    lutShard_t lutShard;
+    lutFile.read(reinterpret_cast<char *>(&shardHeader), sizeof(shardHeader));
+    lutFile.read(reinterpret_cast<char *>(&lutShard), sizeof(lutShard));
+    if (lutFile.gcount() != sizeof(lutShard) || !shardHeader.check_version()) {
+      std::cout << " --- troubles reading header of LUT shard: " << inFile << std::endl;
+      return 1;
+    }
+
+    if (ifile == 0) {
+      lutHeader = shardHeader;
+      nnch = lutHeader.nchmap.nbins;
+      nrad = lutHeader.radmap.nbins;
+      neta = lutHeader.etamap.nbins;
+      npt = lutHeader.ptmap.nbins;
+      lutTable.resize((size_t)nnch * nrad * neta * npt);
+      lutOwner.assign(nnch * neta, -1);
+      lutHeader.print();
+    } else if (!(shardHeader == lutHeader)) {
+      std::cout << " --- header of LUT shard " << inFile << " differs from the one of " << inFiles[0] << std::endl;
+      shardHeader.print();
+      return 1;
+    }
+
+    lutShard.print();
+    if (lutShard.nch[0] < 0 || lutShard.nch[0] >= lutShard.nch[1] || lutShard.nch[1] > nnch ||
+        lutShard.eta[0] < 0 || lutShard.eta[0] >= lutShard.eta[1] || lutShard.eta[1] > neta) {
+      std::cout << " --- LUT shard " << inFile << " is out of the " << nnch << " x " << neta << " LUT bins" << std::endl;
+      return 1;
+    }
+
+    for (int inch = lutShard.nch[0]; inch < lutShard.nch[1]; ++inch) {
+      for (int ieta = lutShard.eta[0]; ieta < lutShard.eta[1]; ++ieta) {
+        auto &owner = lutOwner[inch * neta + ieta];
+        if (owner >= 0) {
+          std::cout << " --- nch bin " << inch << " eta bin " << ieta << " is in both " << inFiles[owner] << " and " << inFile << std::endl;
+          return 1;
+        }
+        owner = ifile;
+      }
+      for (int irad = 0; irad < nrad; ++irad) {
+        for (int ieta = lutShard.eta[0]; ieta < lutShard.eta[1]; ++ieta) {
+          for (int ipt = 0; ipt < npt; ++ipt) {
+            auto &entry = lutTable[(((size_t)inch * nrad + irad) * neta + ieta) * npt + ipt];
+            lutFile.read(reinterpret_cast<char *>(&entry), sizeof(lutEntry_t));
+            if (lutFile.gcount() != sizeof(lutEntry_t)) {
+              std::cout << " --- troubles reading covariance matrix entry from LUT shard: " << inFile << std::endl;
+              return 1;
+            }
+          }
+        }
+      }
+    }
+
+    if (lutFile.peek() != EOF) {
+      std::cout << " --- LUT shard " << inFile << " has more entries than its nch and eta bins" << std::endl;
+      return 1;
+    }
+  }
+
+  // coverage
+  int nMissing = 0;
+  for (int inch = 0; inch < nnch; ++inch)
+    for (int ieta = 0; ieta < neta; ++ieta)
+      if (lutOwner[inch * neta + ieta] < 0) {
+        std::cout << " --- nch bin " << inch << " eta bin " << ieta << " is not in any LUT shard" << std::endl;
+        nMissing++;
+      }
+  if (nMissing > 0) {
+    std::cout << " --- " << nMissing << " bins are missing, the LUT is not written" << std::endl;
+    return 1;
+  }
+
+  // the complete table has no shard record
+  std::ofstream lutFile(outFile, std::ofstream::binary);
+  if (!lutFile.is_open()) {
+    std::cout << " --- cannot open output LUT file: " << outFile << std::endl;
+    return 1;
+  }
+  lutFile.write(reinterpret_cast<char *>(&lutHeader), sizeof(lutHeader));
+  for (auto &entry : lutTable)
+    lutFile.write(reinterpret_cast<char *>(&entry), sizeof(lutEntry_t));
+  lutFile.close();
+  if (!lutFile) {
+    std::cout << " --- troubles writing LUT file: " << outFile << std::endl;
+    return 1;
+  }
+  std::cout << " --- merged " << inFiles.size() << " LUT shards into " << outFile << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/// compiled LUT writer: the geometry is built once and the LUTs
+/// for all requested species and fields are written in one process
+
+#include <boost/program_options.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "TDatabasePDG.h"
+#include "TSystem.h"
+#include "DetectorK.h"
+#include "lutWrite.cc"
+#include "lutScan.cc"
+
+// each writer in its own namespace, they share lutWrite.cc and may clash otherwise
+namespace writer_default {
+#include "lutWrite.default.cc"
+}
+namespace writer_geometry_v1 {
+#include "lutWrite.geometry_v1.cc"
+}
+namespace writer_geometry_v2 {
+#include "lutWrite.geometry_v2.cc"
+}
+namespace writer_geometry_v4 {
+#include "lutWrite.geometry_v4.cc"
+}
+namespace writer_its1 {
+#include "lutWrite.its1.cc"
+}
+namespace writer_its2 {
+#include "lutWrite.its2.cc"
+}
+namespace writer_its3 {
+#include "lutWrite.its3.cc"
+}
+namespace writer_scenario1 {
+#include "lutWrite.scenario1.cc"
+}
+namespace writer_scenario2 {
+#include "lutWrite.scenario2.cc"
+}
+namespace writer_scenario3 {
+#include "lutWrite.scenario3.cc"
+}
+namespace writer_scenario4 {
+#include "lutWrite.scenario4.cc"
+}
+namespace writer_tof1 {
+#include "lutWrite.tof1.cc"
+}
+namespace writer_tof2 {
+#include "lutWrite.tof2.cc"
+}
+namespace writer_v12 {
+#include "lutWrite.v12.cc"
+}
+namespace writer_werner {
+#include "lutWrite.werner.cc"
+}
+
+const std::map<std::string, void (*)(float, float)> fatInits = {
+  {"default", writer_default::fatInit_default},
+  {"geometry_v1", writer_geometry_v1::fatInit_geometry_v1},
+  {"geometry_v2", writer_geometry_v2::fatInit_geometry_v2},
+  {"geometry_v4", writer_geometry_v4::fatInit_geometry_v4},
+  {"its1", writer_its1::fatInit_its1},
+  {"its2", writer_its2::fatInit_its2},
+  {"its3", writer_its3::fatInit_its3},
+  {"scenario1", writer_scenario1::fatInit_scenario1},
+  {"scenario2", writer_scenario2::fatInit_scenario2},
+  {"scenario3", writer_scenario3::fatInit_scenario3},
+  {"scenario4", writer_scenario4::fatInit_scenario4},
+  {"tof1", writer_tof1::fatInit_tof1},
+  {"tof2", writer_tof2::fatInit_tof2},
+  {"v12", writer_v12::fatInit_v12},
+  {"werner", writer_werner::fatInit_werner}
+};
+
+int main(int argc, char** argv)
+{
+
+  std::string what, rmin, outPath, outTag, cacheDir, scanWhat, scanLayer;
+  std::vector<float> fields, scanValues;
+  std::vector<int> particles, nchBins, etaBins;
+  bool noAutoTag, dipole, flatDipole, noEigen;
+
+  /** process arguments **/
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  try {
+    desc.add_options()
+      ("help,h", "Print help messages")
+      ("what,t", po::value<std::string>(&what)->default_value("default"), "Tag of the LUT writer")
+      ("field,B", po::value<std::vector<float>>(&fields)->multitoken()->default_value({0.5}, "0.5"), "Magnetic field in T, more than one value can be given")
+      ("rmin,R", po::value<std::string>(&rmin)->default_value("100."), "Minimum radius of the track in cm")
+      ("rad-bins,r", po::value<int>(&nRadBins)->default_value(1), "Number of production radius bins, for secondaries")
+      ("correction-bg,C", po::value<float>(&correctionBetaGamma)->default_value(0.), "Write species LUTs only up to this beta-gamma, as corrections to the universal LUT")
+      ("particles,P", po::value<std::vector<int>>(&particles)->multitoken()->default_value({0, 1, 2, 3, 4}, "0 1 2 3 4"), "Particles to consider, 8 is the universal LUT")
+      ("output,o", po::value<std::string>(&outPath)->default_value("."), "Output path where to write the LUTs")
+      ("tag,T", po::value<std::string>(&outTag)->default_value(""), "Tag to append to LUTs")
+      ("threads,J", po::value<int>(&nThreads)->default_value(1), "Number of threads solving the LUT bins in parallel")
+      ("pt-batch,b", po::value<int>(&nPtBatch)->default_value(0), "Number of pt bins solved together as one pack of tracks, 0 for all the bins of an eta bin")
+      ("nch-bins,N", po::value<std::vector<int>>(&nchBins)->multitoken()->default_value({0, -1}, "0 -1"), "First and last (excluded) nch bins to write, a partial range writes a shard for lut-merge")
+      ("eta-bins,H", po::value<std::vector<int>>(&etaBins)->multitoken()->default_value({0, -1}, "0 -1"), "First and last (excluded) eta bins to write, a partial range writes a shard for lut-merge")
+      ("scan,S", po::value<std::string>(&scanWhat)->default_value(""), "Layer parameter to scan: radius, radL, resRPhi, resZ or res, fields are scanned with -B")
+      ("scan-layer,L", po::value<std::string>(&scanLayer)->default_value(""), "Layer whose parameter is scanned")
+      ("scan-values,V", po::value<std::vector<float>>(&scanValues)->multitoken(), "Values of the scanned parameter, one LUT family per value")
+      ("cache,K", po::value<std::string>(&cacheDir)->default_value(""), "Directory where LUTs are cached by the hash of their full configuration")
+      ("no-autotag,F", po::bool_switch(&noAutoTag)->default_value(false), "Don't use the automatic tagging and use only the one provided instead")
+      ("dipole,D", po::bool_switch(&dipole)->default_value(false), "Use dipole")
+      ("flat-dipole,d", po::bool_switch(&flatDipole)->default_value(false), "Use dipole flat dipole parametrization")
+      ("no-eigen,E", po::bool_switch(&noEigen)->default_value(false), "Skip the eigen decomposition, write only the Cholesky factor");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 0;
+    }
+  } catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  auto fatInit = fatInits.find(what);
+  if (fatInit == fatInits.end()) {
+    std::cout << "Error: unknown LUT writer \"" << what << "\"" << std::endl;
+    return 1;
+  }
+  if (!scanWhat.empty() && (scanWhat == "field" || scanLayer.empty() || scanValues.empty())) {
+    std::cout << "Error: a scan needs a layer parameter, a layer and its values" << std::endl;
+    return 1;
+  }
+  if (fields.empty()) {
+    std::cout << "Error: at least one field is needed" << std::endl;
+    return 1;
+  }
+  if (nchBins.size() != 2 || etaBins.size() != 2) {
+    std::cout << "Error: the nch and eta bin ranges need two values each" << std::endl;
+    return 1;
+  }
+  shardNch[0] = nchBins[0];
+  shardNch[1] = nchBins[1];
+  shardEta[0] = etaBins[0];
+  shardEta[1] = etaBins[1];
+  useDipole = dipole;
+  useFlatDipole = flatDipole;
+  useEigen = !noEigen;
+  lutCacheDir = cacheDir;
+
+  // the geometry and its hit-density cache are set up once, only the field and the scanned parameter change;
+  // the settings of each writer live in its fatInit_*, shared with the lutWrite_* macros
+  fatInit->second(fields.front(), std::stof(rmin));
+  printLutWriterConfiguration();
+
+  TDatabasePDG::Instance()->AddParticle("deuteron", "deuteron", 1.8756134, kTRUE, 0.0, 3, "Nucleus", 1000010020);
+  TDatabasePDG::Instance()->AddAntiParticle("anti-deuteron", -1000010020);
+
+  TDatabasePDG::Instance()->AddParticle("triton", "triton", 2.8089218, kTRUE, 0.0, 3, "Nucleus", 1000010030);
+  TDatabasePDG::Instance()->AddAntiParticle("anti-triton", -1000010030);
+
+  TDatabasePDG::Instance()->AddParticle("helium3", "helium3", 2.80839160743, kTRUE, 0.0, 6, "Nucleus", 1000020030);
+  TDatabasePDG::Instance()->AddAntiParticle("anti-helium3", -1000020030);
+
+  const int N = 9;
+  const TString pn[N] = {"el", "mu", "pi", "ka", "pr", "de", "tr", "he3", "un"};
+  const int pc[N] = {11, 13, 211, 321, 2212, 1000010020, 1000010030, 1000020030, 0 };
+
+  int nFailed = 0;
+  const int nPoints = scanWhat.empty() ? 1 : scanValues.size();
+  for (auto field : fields) {
+    // set after fatInit as well, in case the writer does not use its field argument
+    fat.SetBField(field);
+    for (int ipoint = 0; ipoint < nPoints; ++ipoint) {
+      TString tag = outTag;
+      if (!scanWhat.empty()) {
+        if (!lutScanSet(fat, scanWhat, scanLayer.c_str(), scanValues[ipoint])) return 1;
+        tag = lutScanTag(scanWhat, scanLayer.c_str(), scanValues[ipoint]) + tag;
+      }
+      if (!noAutoTag) {
+        if (dipole) tag += "_Dipole";
+        if (flatDipole) tag += "_FlatDipole";
+        tag = Form(".%gkG.rmin%s.%s%s", field * 10., rmin.c_str(), what.c_str(), tag.Data());
+      }
+      for (auto i : particles) {
+        if (i < 0 || i >= N) {
+          Printf("Particle ID %i is too large or too small", i);
+          nFailed++;
+          continue;
+        }
+        const TString out_file = TString(outPath) + "/lutCovm." + pn[i] + tag + ".dat";
+        Printf("Creating LUT for particle ID %i: %s with pdg code %i to %s", i, pn[i].Data(), pc[i], out_file.Data());
+        lutWrite(out_file, pc[i], field);
+        FileStat_t stat;
+        if (gSystem->GetPathInfo(out_file, stat) != 0 || stat.fSize <= (Long64_t)sizeof(lutHeader_t)) {
+          Printf("LUT file %s for particle %i has no entries", out_file.Data(), i);
+          nFailed++;
+        }
+      }
+    }
+  }
+
+  return nFailed > 0 ? 1 : 0;
+}
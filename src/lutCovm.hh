@@ -2,20 +2,20 @@
 /// @email: preghenella@bo.infn.it
 
 #pragma once
-#define LUTCOVM_VERSION 20210801
+#define LUTCOVM_VERSION 20211115
 
 struct map_t {
   int nbins = 1;
   float min = 0.;
   float max = 1.e6;
   bool log = false;
-  float eval(int bin) {
+  float eval(int bin) const {
     float width = (max - min) / nbins;
     float val = min + (bin + 0.5) * width;
     if (log) return pow(10., val);
     return val;
   };
-  int find(float val) {
+  int find(float val) const {
     float width = (max - min) / nbins;
     int bin;
     if (log) bin = (int)((log10(val) - min) / width);
@@ -24,13 +24,38 @@ struct map_t {
     if (bin > nbins - 1) return nbins - 1;
     return bin;
   };
+  bool contains(float val) const {
+    if (log) {
+      if (!(val > 0.)) return false;
+      val = log10(val);
+    }
+    return val >= min && val <= max;
+  };
+  void interp(float val, int &bin, float &frac) const {
+    // lower bin and fractional distance to the next bin, measured between bin centres
+    bin = 0;
+    frac = 0.;
+    if (log && !(val > 0.)) return;
+    float width = (max - min) / nbins;
+    float pos;
+    if (log) pos = (log10(val) - min) / width - 0.5;
+    else pos = (val - min) / width - 0.5;
+    if (!(pos > 0.)) return;
+    bin = (int)pos;
+    if (bin > nbins - 2) {
+      bin = nbins - 1;
+      return;
+    }
+    frac = pos - bin;
+  };
+  bool operator==(const map_t &o) const { return nbins == o.nbins && min == o.min && max == o.max && log == o.log; };
   void print() { printf("nbins = %d, min = %f, max = %f, log = %s \n", nbins, min, max, log ? "on" : "off"); };
 };
 
 struct lutHeader_t {
   int   version = LUTCOVM_VERSION;
-  int   pdg = 0;
-  float mass = 0.;
+  int   pdg = 0;   // 0: universal LUT, unit charge with ptmap in pt/mass
+  float mass = 0.; // mass the LUT was solved with
   float field = 0.;
   map_t nchmap;
   map_t radmap;
@@ -39,6 +64,10 @@ struct lutHeader_t {
   bool check_version() {
     return (version == LUTCOVM_VERSION);
   };
+  bool operator==(const lutHeader_t &o) const {
+    return version == o.version && pdg == o.pdg && mass == o.mass && field == o.field &&
+      nchmap == o.nchmap && radmap == o.radmap && etamap == o.etamap && ptmap == o.ptmap;
+  };
   void print() {
     printf(" version: %d \n", version);
     printf("     pdg: %d \n", pdg);
@@ -50,6 +79,15 @@ struct lutHeader_t {
   };
 };
 
+struct lutShard_t {
+  // partial LUT files carry this record after the header, with the
+  // entries of the [first, last) nch and eta bins only, for lut-merge
+  int nch[2] = {0, 0};
+  int eta[2] = {0, 0};
+  bool contains(int inch, int ieta) const { return inch >= nch[0] && inch < nch[1] && ieta >= eta[0] && ieta < eta[1]; };
+  void print() { printf(" --- lutShard: nch bins [%d, %d), eta bins [%d, %d)\n", nch[0], nch[1], eta[0], eta[1]); };
+};
+
 struct lutEntry_t {
   float nch = 0.;
   float eta = 0.;
@@ -63,6 +101,42 @@ struct lutEntry_t {
   float eigval[5] = {0.};
   float eigvec[5][5] = {0.};
   float eiginv[5][5] = {0.};
+  float chol[15] = {0.}; // lower-triangular Cholesky factor of covm, same packing
+  void cholesky() {
+    // closed-form Cholesky-Banachiewicz, non-positive pivots zero the column
+    for (int i = 0, ki = 0; i < 5; ki += ++i) {
+      for (int j = 0, kj = 0; j < i + 1; kj += ++j) {
+        double sum = covm[ki + j];
+        for (int k = 0; k < j; ++k)
+          sum -= (double)chol[ki + k] * chol[kj + k];
+        if (i == j) chol[ki + j] = sum > 0. ? sqrt(sum) : 0.;
+        else chol[ki + j] = chol[kj + j] > 0. ? sum / chol[kj + j] : 0.;
+      }
+    }
+  };
+  void mirror() {
+    // eta -> -eta: z and tgl change sign, so do their correlations with the other parameters
+    const float sign[5] = {1., -1., 1., -1., 1.};
+    eta = -eta;
+    for (int i = 0, k = 0; i < 5; ++i)
+      for (int j = 0; j < i + 1; ++j, ++k) {
+        covm[k] *= sign[i] * sign[j];
+        chol[k] *= sign[i] * sign[j];
+      }
+    for (int i = 0; i < 5; ++i)
+      for (int j = 0; j < 5; ++j) {
+        eigvec[i][j] *= sign[i];
+        eiginv[i][j] *= sign[j];
+      }
+  };
+  bool isMirrorOf(const lutEntry_t &o) const {
+    lutEntry_t m = o;
+    m.mirror();
+    if (valid != m.valid || eff != m.eff || eff2 != m.eff2 || itof != m.itof || otof != m.otof) return false;
+    for (int k = 0; k < 15; ++k)
+      if (covm[k] != m.covm[k]) return false;
+    return true;
+  };
   void print() {
     printf(" --- lutEntry: pt = %f, eta = %f (%s)\n", pt, eta, valid ? "valid" : "not valid");
     printf("     efficiency: %f\n", eff);
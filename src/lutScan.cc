@@ -0,0 +1,79 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/// design scans: one parameter of a geometry is varied and the LUTs of all
+/// the points are written in one session, to be loaded after a lutWrite.<what>.cc
+///
+///   DetectorK det;
+///   fatInit_scenario1(det, 0.5, 100.);
+///   lutScan(det, "radius", "ddd1", {1.5, 1.8, 2.1}, 211, "lutCovm.pi.scenario1");
+///
+/// the geometry is built once and only the scanned parameter changes between
+/// the points, the hit-density table is recomputed only when a radius moves
+
+#include "lutWrite.cc"
+#include <string>
+#include <vector>
+
+bool
+lutScanSet(DetectorK &det, const std::string &what, const char *layer, float value)
+{
+  if (what == "field") {
+    det.SetBField(value);
+    return true;
+  }
+  if (!det.FindLayer((char *)layer)) {
+    Printf("Layer %s not found in the geometry", layer);
+    return false;
+  }
+  if (what == "radius") det.SetRadius((char *)layer, value);
+  else if (what == "radL") det.SetRadiationLength((char *)layer, value);
+  else if (what == "resRPhi") det.SetResolution((char *)layer, value, det.GetResolution((char *)layer, 1));
+  else if (what == "resZ") det.SetResolution((char *)layer, det.GetResolution((char *)layer, 0), value);
+  else if (what == "res") det.SetResolution((char *)layer, value, value);
+  else {
+    Printf("Unknown scan parameter %s, use radius, radL, resRPhi, resZ, res or field", what.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::vector<float>
+lutScanGet(DetectorK &det, const std::string &what, const char *layer)
+{
+  // current value(s) of the scanned parameter, to restore the geometry after the scan
+  if (what == "field") return {det.GetBField()};
+  if (what == "radius") return {det.GetRadius((char *)layer)};
+  if (what == "radL") return {det.GetRadiationLength((char *)layer)};
+  return {det.GetResolution((char *)layer, 0), det.GetResolution((char *)layer, 1)};
+}
+
+TString
+lutScanTag(const std::string &what, const char *layer, float value)
+{
+  if (what == "field") return Form(".%gkG", value * 10.);
+  return Form(".%s.%s%g", layer, what.c_str(), value);
+}
+
+int
+lutScan(DetectorK &det, const char *what, const char *layer, std::vector<float> values, int pdg = 211, const char *prefix = "lutCovm", int itof = 0, int otof = 0)
+{
+  // writes <prefix><tag>.dat for each value, returns the number of LUTs written
+  const std::string swhat = what;
+  auto saved = lutScanGet(det, swhat, layer);
+  auto lutFatSaved = lutFat;
+  lutFat = &det;
+  int nWritten = 0;
+  for (auto value : values) {
+    if (!lutScanSet(det, swhat, layer, value)) break;
+    TString filename = TString(prefix) + lutScanTag(swhat, layer, value) + ".dat";
+    std::cout << " --- scan point " << what << " = " << value << ": " << filename << std::endl;
+    lutWrite(filename, pdg, det.GetBField(), itof, otof);
+    if (!gSystem->AccessPathName(filename)) nWritten++;
+  }
+  // restore the geometry
+  if (saved.size() == 2) det.SetResolution((char *)layer, saved[0], saved[1]);
+  else lutScanSet(det, swhat, layer, saved[0]);
+  lutFat = lutFatSaved;
+  return nWritten;
+}
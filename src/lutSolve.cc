@@ -0,0 +1,68 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/// on-demand LUTs: the smearer solves the bins with the geometry in `lutFat`
+/// the first time a track needs them, to be loaded after a lutWrite.<what>.cc
+
+#include "TrackSmearer.hh"
+#include "lutWrite.cc"
+#include <map>
+#include <mutex>
+
+bool
+lutLoadOnDemand(o2::delphes::TrackSmearer &smearer, int pdg, float field, int itof = 0, int otof = 0)
+{
+  lutHeader_t lutHeader;
+  int q;
+  if (!lutMakeHeader(lutHeader, q, pdg, field)) return false;
+
+  // the full table if it is in the cache, otherwise the bins solved so far
+  TString solvedFile;
+  if (!lutCacheDir.IsNull()) {
+    auto key = lutCacheKey(lutHeader, itof, otof);
+    auto cachedFile = lutCacheDir + "/lutCovm." + key + ".dat";
+    if (!gSystem->AccessPathName(cachedFile)) {
+      std::cout << " --- LUT cache hit: " << cachedFile << std::endl;
+      return smearer.loadTable(pdg, cachedFile);
+    }
+    gSystem->mkdir(lutCacheDir, kTRUE);
+    solvedFile = lutCacheDir + "/lutCovm." + key + ".solved.dat";
+  }
+
+  // the bins are solved with the geometry current at load time, also if another one is set up later;
+  // the first bin needed in an (nch, rad) slice solves the whole slice, which is kept by the solver,
+  // and the geometry gets back its multiplicity and production radius afterwards
+  struct slices_t {
+    std::mutex mutex;
+    std::map<int, std::vector<lutEntry_t>> slice;
+  };
+  auto det = lutFat;
+  auto slices = std::make_shared<slices_t>();
+  auto solver = [det, slices, q, itof, otof](lutEntry_t &lutEntry, const lutHeader_t &lutHeader, int inch, int irad, int ieta, int ipt) {
+    const int neta = lutHeader.etamap.nbins;
+    const int npt = lutHeader.ptmap.nbins;
+    std::lock_guard<std::mutex> lock(slices->mutex);
+    auto &lutSlice = slices->slice[inch * lutHeader.radmap.nbins + irad];
+    if (lutSlice.empty()) {
+      auto fat = lutFat;
+      auto nch = det->GetdNdEtaCent();
+      auto rad = det->GetProductionRadius();
+      const Bool_t logTermMS = AliExternalTrackParam::GetUseLogTermMS();
+      lutFat = det;
+      lutEntry_t lutEntryNch;
+      lutEntryNch.nch = lutHeader.nchmap.eval(inch);
+      lutSlice.assign(neta * npt, lutEntryNch);
+      if (nch != lutEntryNch.nch) lutFat->SetdNdEtaCent(lutEntryNch.nch);
+      // tracks are solved at the lower edge of the radius bin, as in lutWrite
+      lutFat->SetProductionRadius(lutHeader.radmap.min + irad * (lutHeader.radmap.max - lutHeader.radmap.min) / lutHeader.radmap.nbins);
+      lutSolveSlice(lutSlice.data(), lutHeader, 0, neta, q, itof, otof);
+      if (nch != lutFat->GetdNdEtaCent()) lutFat->SetdNdEtaCent(nch);
+      lutFat->SetProductionRadius(rad);
+      lutFat = fat;
+      AliExternalTrackParam::SetUseLogTermMS(logTermMS);
+    }
+    lutEntry = lutSlice[ieta * npt + ipt];
+    return lutEntry.valid;
+  };
+  return smearer.setTableSolver(pdg, lutHeader, solver, solvedFile);
+}
@@ -4,23 +4,66 @@
 #ifndef lutWrite_CC
 #define lutWrite_CC
 #include "lutCovm.hh"
+#define LUTWRITE_VERSION 1 // to be bumped whenever the solving changes the written tables
 #include "fwdRes/fwdRes.C"
+#include "TROOT.h"
+#include "TMD5.h"
+#include "TSystem.h"
+#include "TDatabasePDG.h"
+#include "TMatrixD.h"
+#include "TMatrixDSym.h"
+#include "TMatrixDSymEigen.h"
+#include "TVectorD.h"
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <memory>
 
-DetectorK fat;
+DetectorK fat;              // the geometry set up by the fatInit_* of the writers
+DetectorK *lutFat = &fat;   // the geometry the LUTs are solved with, other DetectorK can be set up side by side
 void diagonalise(lutEntry_t &lutEntry);
+TString lutCacheKey(const lutHeader_t &lutHeader, int itof, int otof);
+bool lutMakeHeader(lutHeader_t &lutHeader, int &q, int pdg, float field);
+void factorise(lutEntry_t &lutEntry);
+bool fatFill(lutEntry_t &lutEntry, TrackSol &tr, int itof, int otof);
 static float etaMaxBarrel = 1.75;
 
-bool usePara = true;        // use fwd parameterisation
+bool usePara = true;        // use the fwd parameterisation, false for the Kalman fit on the forward disks of fwdRes.C
 bool useDipole = false;     // use dipole i.e. flat parametrization for efficiency and momentum resolution
 bool useFlatDipole = false; // use dipole i.e. flat parametrization outside of the barrel
+bool useEigen = true;       // store also the eigen decomposition next to the Cholesky factor
+int nRadBins = 1;           // production radius bins, the first one always starts at the primary vertex
+float radMax = 100.;        // maximum production radius [cm]
+float correctionBetaGamma = 0.; // if > 0, species LUTs only cover pt < correctionBetaGamma * mass, on top of the universal LUT
+int nThreads = 1;           // threads solving the eta bins of each multiplicity and radius
+int nPtBatch = 0;           // pt bins of a barrel eta bin solved as one pack by DetectorK::SolveTracks, 0 for all of them
+bool useEtaSymmetry = true; // solve eta >= 0 only and mirror the rest when the eta binning is symmetric
+TString lutCacheDir = "";   // if set, LUTs are cached there by the hash of the geometry and of the writer configuration
+int shardNch[2] = {0, -1};  // [first, last) nch bins to write, last < 0 for all, a partial range writes a shard
+int shardEta[2] = {0, -1};  // [first, last) eta bins to write, last < 0 for all, a partial range writes a shard
 
 void printLutWriterConfiguration()
 {
   std::cout << " --- Printing configuration of LUT writer --- " << std::endl;
   std::cout << "    -> etaMaxBarrel  = " << etaMaxBarrel << std::endl;
   std::cout << "    -> usePara       = " << usePara << std::endl;
+  std::cout << "    -> fwdMinHits    = " << fwdMinHits << std::endl;
   std::cout << "    -> useDipole     = " << useDipole << std::endl;
   std::cout << "    -> useFlatDipole = " << useFlatDipole << std::endl;
+  std::cout << "    -> useEigen      = " << useEigen << std::endl;
+  std::cout << "    -> useEtaSymmetry = " << useEtaSymmetry << std::endl;
+  std::cout << "    -> nRadBins      = " << nRadBins << std::endl;
+  std::cout << "    -> radMax        = " << radMax << std::endl;
+  std::cout << "    -> correctionBetaGamma = " << correctionBetaGamma << std::endl;
+  std::cout << "    -> nThreads      = " << nThreads << std::endl;
+  std::cout << "    -> nPtBatch      = " << nPtBatch << std::endl;
+  std::cout << "    -> lutCacheDir   = " << lutCacheDir << std::endl;
+  std::cout << "    -> shardNch      = " << shardNch[0] << " " << shardNch[1] << std::endl;
+  std::cout << "    -> shardEta      = " << shardEta[0] << " " << shardEta[1] << std::endl;
+  if (!usePara) fwdPrintDisks();
 }
 
 bool
@@ -31,25 +74,32 @@ fatSolve(lutEntry_t &lutEntry, float pt = 0.1, float eta = 0.0, float mass = 0.1
   // solve track
   if (q > 1) mass = -mass;
   TrackSol tr(1, pt, eta, q, mass);
-  if (!fat.SolveTrack(tr)) return false;
+  if (!lutFat->SolveTrack(tr)) return false;
+  return fatFill(lutEntry, tr, itof, otof);
+}
+
+bool
+fatFill(lutEntry_t &lutEntry, TrackSol &tr, int itof, int otof)
+{
+  // fills the entry from a solved track
   AliExternalTrackParam *trPtr = (AliExternalTrackParam*)tr.fTrackCmb.At(0);
   if (!trPtr) return false;
 
   lutEntry.valid = true;
-  lutEntry.itof = fat.GetGoodHitProb(itof);
-  lutEntry.otof = fat.GetGoodHitProb(otof);
+  lutEntry.itof = tr.fGoodHitProb[itof];
+  lutEntry.otof = tr.fGoodHitProb[otof];
   for (int i = 0; i < 15; ++i) lutEntry.covm[i] = trPtr->GetCovariance()[i];
 
   // define the efficiency
   auto totfake = 0.;
   lutEntry.eff = 1.;
   for (int i = 1; i < 20; ++i) {
-    auto igoodhit = fat.GetGoodHitProb(i);
+    auto igoodhit = tr.fGoodHitProb[i];
     if (igoodhit <= 0. || i == itof || i == otof) continue;
     lutEntry.eff *= igoodhit;
     auto pairfake = 0.;
     for (int j = i + 1; j < 20; ++j) {
-      auto jgoodhit = fat.GetGoodHitProb(j);
+      auto jgoodhit = tr.fGoodHitProb[j];
       if (jgoodhit <= 0. || j == itof || j == otof) continue;
       pairfake = (1. - igoodhit) * (1. - jgoodhit);
       break;
@@ -62,10 +112,11 @@ fatSolve(lutEntry_t &lutEntry, float pt = 0.1, float eta = 0.0, float mass = 0.1
 }
 
 bool
-fwdSolve(float *covm, float pt = 0.1, float eta = 0.0, float mass = 0.13957000)
+fwdSolve(float *covm, float &eff, float pt = 0.1, float eta = 0.0, float mass = 0.13957000, int q = 1, float field = 0.5)
 {
-  if (fwdRes(covm, pt, eta, mass) < 0) return false;
-  return true;
+  bool ok;
+  fwdSolveTracks(1, &pt, eta, mass, q, field * 10., covm, &eff, &ok);
+  return ok;
 }
 
 bool
@@ -124,31 +175,189 @@ fwdPara(lutEntry_t &lutEntry, float pt = 0.1, float eta = 0.0, float mass = 0.13
   return true;
 }
 
+float
+lutInitEntry(lutEntry_t &lutEntry, const lutHeader_t &lutHeader, int ieta, int ipt)
+{
+  // resets the entry of an (eta, pt) bin, keeping its nch, and returns the pt to solve it at
+  auto nch = lutEntry.nch;
+  lutEntry = lutEntry_t();
+  lutEntry.nch = nch;
+  lutEntry.eta = lutHeader.etamap.eval(ieta);
+  lutEntry.pt = lutHeader.ptmap.eval(ipt);
+  return lutHeader.pdg == 0 ? lutEntry.pt * lutHeader.mass : lutEntry.pt;
+}
+
 void
-lutWrite(const char* filename = "lutCovm.dat", int pdg = 211, float field = 0.2, int itof = 0, int otof = 0)
+lutSolve(lutEntry_t &lutEntry, const lutHeader_t &lutHeader, int ieta, int ipt, int q, int itof = 0, int otof = 0)
+{
+  // solves one (eta, pt) bin, the geometry is only read so that bins can be solved in parallel
+  const float field = lutHeader.field;
+  auto pt = lutInitEntry(lutEntry, lutHeader, ieta, ipt);
+  auto eta = lutEntry.eta;
+  lutEntry.valid = true;
+  if (fabs(eta) <= etaMaxBarrel) { // full lever arm ends at etaMaxBarrel
+    // printf(" --- fatSolve: pt = %f, eta = %f, mass = %f, field=%f \n", pt, lutEntry.eta, lutHeader.mass, lutHeader.field);
+    if (!fatSolve(lutEntry, pt, lutEntry.eta, lutHeader.mass, itof, otof, q)) {
+      // printf(" --- fatSolve: error \n");
+      lutEntry.valid = false;
+      lutEntry.eff = 0.;
+      lutEntry.eff2 = 0.;
+      for (int i = 0; i < 15; ++i)
+        lutEntry.covm[i] = 0.;
+    }
+  } else {
+    // printf(" --- fwdSolve: pt = %f, eta = %f, mass = %f, field=%f \n", pt, lutEntry.eta, lutHeader.mass, lutHeader.field);
+    lutEntry.eff = 1.;
+    lutEntry.eff2 = 1.;
+    bool retval = true;
+    if (useFlatDipole) { // Using the parametrization at the border of the barrel
+      retval = fatSolve(lutEntry, pt, etaMaxBarrel, lutHeader.mass, itof, otof, q);
+    } else if (usePara) {
+      retval = fwdPara(lutEntry, pt, lutEntry.eta, lutHeader.mass, field);
+    } else {
+      retval = fwdSolve(lutEntry.covm, lutEntry.eff, pt, lutEntry.eta, lutHeader.mass, q, field);
+      lutEntry.eff2 = lutEntry.eff;
+    }
+    if (useDipole) { // Using the parametrization at the border of the barrel only for efficiency and momentum resolution
+      lutEntry_t lutEntryBarrel;
+      retval = fatSolve(lutEntryBarrel, pt, etaMaxBarrel, lutHeader.mass, itof, otof, q);
+      lutEntry.valid = lutEntryBarrel.valid;
+      lutEntry.covm[14] = lutEntryBarrel.covm[14];
+      lutEntry.eff = lutEntryBarrel.eff;
+      lutEntry.eff2 = lutEntryBarrel.eff2;
+    }
+    if (!retval) {
+      // printf(" --- fwdSolve: error \n");
+      lutEntry.valid = false;
+      for (int i = 0; i < 15; ++i)
+        lutEntry.covm[i] = 0.;
+    }
+  }
+  factorise(lutEntry);
+}
+
+bool
+lutFwdKalman(float eta)
 {
+  // the bins at eta are solved by the Kalman fit on the forward disks only, without DetectorK
+  return fabs(eta) > etaMaxBarrel && !useFlatDipole && !useDipole && !usePara;
+}
 
-  if (useFlatDipole && useDipole) {
-    Printf("Both dipole and dipole flat flags are on, please use only one of them");
+void
+lutSolveRow(lutEntry_t *lutRow, const lutHeader_t &lutHeader, int ieta, int q, int itof = 0, int otof = 0)
+{
+  // solves all the pt bins of an eta bin, in the barrel they go through DetectorK as packs of nPtBatch tracks
+  const int npt = lutHeader.ptmap.nbins;
+  const float eta = lutHeader.etamap.eval(ieta);
+  if (lutFwdKalman(eta)) {
+    // Kalman fit on the forward disks, the eta-dependent setup is shared by the pt bins
+    std::vector<float> pts(npt), covms(npt * 15), effs(npt);
+    std::unique_ptr<bool[]> solved(new bool[npt]);
+    for (int ipt = 0; ipt < npt; ++ipt)
+      pts[ipt] = lutInitEntry(lutRow[ipt], lutHeader, ieta, ipt);
+    fwdSolveTracks(npt, pts.data(), eta, lutHeader.mass, q, lutHeader.field * 10., covms.data(), effs.data(), solved.get());
+    for (int ipt = 0; ipt < npt; ++ipt) {
+      auto &lutEntry = lutRow[ipt];
+      lutEntry.valid = solved[ipt];
+      lutEntry.eff = effs[ipt];
+      lutEntry.eff2 = effs[ipt];
+      for (int i = 0; i < 15; ++i)
+        lutEntry.covm[i] = solved[ipt] ? covms[ipt * 15 + i] : 0.;
+      factorise(lutEntry);
+    }
     return;
   }
-
-  // output file
-  ofstream lutFile(filename, std::ofstream::binary);
-  if (!lutFile.is_open()) {
-    Printf("Did not manage to open output file!!");
+  if (fabs(eta) > etaMaxBarrel || nPtBatch == 1) {
+    for (int ipt = 0; ipt < npt; ++ipt)
+      lutSolve(lutRow[ipt], lutHeader, ieta, ipt, q, itof, otof);
     return;
   }
+  const float mass = q > 1 ? -lutHeader.mass : lutHeader.mass;
+  const int nBatch = nPtBatch > 0 ? nPtBatch : npt;
+  for (int ipt0 = 0; ipt0 < npt; ipt0 += nBatch) {
+    const int n = std::min(nBatch, npt - ipt0);
+    std::vector<std::unique_ptr<TrackSol>> tracks;
+    std::vector<TrackSol *> pack;
+    for (int ipt = ipt0; ipt < ipt0 + n; ++ipt) {
+      auto pt = lutInitEntry(lutRow[ipt], lutHeader, ieta, ipt);
+      tracks.emplace_back(new TrackSol(1, pt, eta, q, mass));
+      pack.push_back(tracks.back().get());
+    }
+    std::unique_ptr<Bool_t[]> solved(new Bool_t[n]);
+    lutFat->SolveTracks(pack.data(), n, solved.get());
+    for (int i = 0; i < n; ++i) {
+      auto &lutEntry = lutRow[ipt0 + i];
+      if (!solved[i] || !fatFill(lutEntry, *tracks[i], itof, otof)) {
+        lutEntry.valid = false;
+        lutEntry.eff = 0.;
+        lutEntry.eff2 = 0.;
+        for (int j = 0; j < 15; ++j)
+          lutEntry.covm[j] = 0.;
+      }
+      factorise(lutEntry);
+    }
+  }
+}
 
-  // write header
-  lutHeader_t lutHeader;
-  // pid
+void
+lutSolveSlice(lutEntry_t *lutSlice, const lutHeader_t &lutHeader, int etaFirst, int etaLast, int q, int itof = 0, int otof = 0)
+{
+  // solves the eta bins [etaFirst, etaLast) of an (nch, rad) slice with the current geometry, on a pool of nThreads;
+  // the MS log term of AliExternalTrackParam is set here for each kind of bin, never by the threads
+  const int neta = lutHeader.etamap.nbins;
+  const int npt = lutHeader.ptmap.nbins;
+
+  // the barrel layers are cylinders and the forward planes are mirrored,
+  // the bins at -eta are the mirror of the ones at eta for a symmetric binning
+  const bool etaSymmetric = useEtaSymmetry && lutHeader.etamap.min == -lutHeader.etamap.max;
+  const int netaMirrored = etaSymmetric ? neta / 2 : 0;
+
+  // the mirrored eta bins are solved through their partner, also when it is outside the range
+  std::vector<int> etaBins;
+  for (int ieta = etaFirst; ieta < etaLast; ++ieta) {
+    int jeta = ieta < netaMirrored ? neta - 1 - ieta : ieta;
+    if (jeta != ieta && jeta < etaLast) continue;
+    etaBins.push_back(jeta);
+  }
+  for (bool fwdKalman : {false, true}) {
+    std::vector<int> poolBins;
+    for (auto ieta : etaBins)
+      if (lutFwdKalman(lutHeader.etamap.eval(ieta)) == fwdKalman) poolBins.push_back(ieta);
+    if (poolBins.empty()) continue;
+    AliExternalTrackParam::SetUseLogTermMS(!fwdKalman);
+    std::atomic<int> nextBin(0);
+    auto worker = [&]() {
+      for (int ibin = nextBin++; ibin < (int)poolBins.size(); ibin = nextBin++)
+        lutSolveRow(&lutSlice[poolBins[ibin] * npt], lutHeader, poolBins[ibin], q, itof, otof);
+    };
+    std::vector<std::thread> pool;
+    for (int ith = 1; ith < nThreads; ++ith)
+      pool.emplace_back(worker);
+    worker();
+    for (auto &th : pool)
+      th.join();
+  }
+  for (int ieta = etaFirst; ieta < std::min(netaMirrored, etaLast); ++ieta)
+    for (int ipt = 0; ipt < npt; ++ipt) {
+      auto &entry = lutSlice[ieta * npt + ipt];
+      entry = lutSlice[(neta - 1 - ieta) * npt + ipt];
+      entry.mirror();
+      entry.eta = lutHeader.etamap.eval(ieta);
+    }
+}
+
+bool
+lutMakeHeader(lutHeader_t &lutHeader, int &q, int pdg, float field)
+{
+  // header and binning of the LUT, q is the charge the tracks are solved with
+  // pid, pdg = 0 is the universal LUT: unit charge, solved for pions and binned in pt/mass
+  const bool universal = (pdg == 0);
   lutHeader.pdg = pdg;
-  lutHeader.mass = TDatabasePDG::Instance()->GetParticle(pdg)->Mass();
-  const int q = std::abs(TDatabasePDG::Instance()->GetParticle(pdg)->Charge()) / 3;
+  lutHeader.mass = TDatabasePDG::Instance()->GetParticle(universal ? 211 : pdg)->Mass();
+  q = universal ? 1 : std::abs(TDatabasePDG::Instance()->GetParticle(pdg)->Charge()) / 3;
   if (q <= 0) {
     Printf("Negative or null charge (%f) for pdg code %i. Fix the charge!", TDatabasePDG::Instance()->GetParticle(pdg)->Charge(), pdg);
-    return;
+    return false;
   }
   lutHeader.field = field;
   // nch
@@ -158,9 +367,9 @@ lutWrite(const char* filename = "lutCovm.dat", int pdg = 211, float field = 0.2,
   lutHeader.nchmap.max   = 3.5;
   // radius
   lutHeader.radmap.log   = false;
-  lutHeader.radmap.nbins = 1;
+  lutHeader.radmap.nbins = nRadBins;
   lutHeader.radmap.min   = 0.;
-  lutHeader.radmap.max   = 100.;
+  lutHeader.radmap.max   = radMax;
   // eta
   lutHeader.etamap.log   = false;
   lutHeader.etamap.nbins = 80;
@@ -171,73 +380,145 @@ lutWrite(const char* filename = "lutCovm.dat", int pdg = 211, float field = 0.2,
   lutHeader.ptmap.nbins  = 200;
   lutHeader.ptmap.min    = -2;
   lutHeader.ptmap.max    = 2.;
-  lutFile.write(reinterpret_cast<char *>(&lutHeader), sizeof(lutHeader));
-  
-  // entries
+  if (universal) { // beta-gamma from 0.03 to 1000, same bin width
+    lutHeader.ptmap.nbins = 225;
+    lutHeader.ptmap.min   = -1.5;
+    lutHeader.ptmap.max   = 3.;
+  } else if (correctionBetaGamma > 0.) { // only where the energy loss breaks the mass scaling
+    lutHeader.ptmap.max   = log10(correctionBetaGamma * lutHeader.mass);
+    lutHeader.ptmap.nbins = std::ceil((lutHeader.ptmap.max - lutHeader.ptmap.min) / 0.02);
+    if (lutHeader.ptmap.nbins <= 0) {
+      Printf("Correction LUT for pdg code %i would be empty, increase correctionBetaGamma", pdg);
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+lutWrite(const char* filename = "lutCovm.dat", int pdg = 211, float field = 0.2, int itof = 0, int otof = 0)
+{
+
+  if (useFlatDipole && useDipole) {
+    Printf("Both dipole and dipole flat flags are on, please use only one of them");
+    return;
+  }
+
+  if (nThreads > 1) ROOT::EnableThreadSafety();
+
+  // header
+  lutHeader_t lutHeader;
+  int q;
+  if (!lutMakeHeader(lutHeader, q, pdg, field)) return;
+
+  // shard of the (nch, eta) bins to write
   const int nnch = lutHeader.nchmap.nbins;
   const int nrad = lutHeader.radmap.nbins;
   const int neta = lutHeader.etamap.nbins;
   const int npt = lutHeader.ptmap.nbins;
+  lutShard_t lutShard;
+  lutShard.nch[0] = shardNch[0];
+  lutShard.nch[1] = shardNch[1] < 0 ? nnch : shardNch[1];
+  lutShard.eta[0] = shardEta[0];
+  lutShard.eta[1] = shardEta[1] < 0 ? neta : shardEta[1];
+  if (lutShard.nch[0] < 0 || lutShard.nch[0] >= lutShard.nch[1] || lutShard.nch[1] > nnch ||
+      lutShard.eta[0] < 0 || lutShard.eta[0] >= lutShard.eta[1] || lutShard.eta[1] > neta) {
+    Printf("Shard nch bins [%d, %d) eta bins [%d, %d) is out of the %d x %d LUT bins", shardNch[0], shardNch[1], shardEta[0], shardEta[1], nnch, neta);
+    return;
+  }
+  const bool isShard = lutShard.nch[0] > 0 || lutShard.nch[1] < nnch || lutShard.eta[0] > 0 || lutShard.eta[1] < neta;
+  if (isShard) lutShard.print();
+
+  // identical requests are served from the cache, shards are not cached
+  TString cachedFile;
+  if (!lutCacheDir.IsNull() && !isShard) {
+    cachedFile = lutCacheDir + "/lutCovm." + lutCacheKey(lutHeader, itof, otof) + ".dat";
+    if (!gSystem->AccessPathName(cachedFile)) {
+      std::cout << " --- LUT cache hit: " << cachedFile << std::endl;
+      if (gSystem->CopyFile(cachedFile, filename, kTRUE) != 0)
+        Printf("Did not manage to copy %s to %s", cachedFile.Data(), filename);
+      return;
+    }
+    std::cout << " --- LUT cache miss: " << cachedFile << std::endl;
+  }
+
+  // output file
+  std::ofstream lutFile(filename, std::ofstream::binary);
+  if (!lutFile.is_open()) {
+    Printf("Did not manage to open output file!!");
+    return;
+  }
+  lutFile.write(reinterpret_cast<char *>(&lutHeader), sizeof(lutHeader));
+  if (isShard) lutFile.write(reinterpret_cast<char *>(&lutShard), sizeof(lutShard));
+  
+  if (useEtaSymmetry && lutHeader.etamap.min == -lutHeader.etamap.max)
+    std::cout << " --- eta binning is symmetric, solving eta >= 0 only" << std::endl;
+
+  // entries
   lutEntry_t lutEntry;
+
+  // the MS log term is a global switch of AliExternalTrackParam, set by lutSolveSlice
+  const Bool_t logTermMS = AliExternalTrackParam::GetUseLogTermMS();
   
   // write entries
-  for (int inch = 0; inch < nnch; ++inch) {
+  for (int inch = lutShard.nch[0]; inch < lutShard.nch[1]; ++inch) {
     auto nch = lutHeader.nchmap.eval(inch);
     lutEntry.nch = nch;
-    fat.SetdNdEtaCent(nch);
+    lutFat->SetdNdEtaCent(nch);
     std::cout << " --- setting FAT dN/deta: " << nch << std::endl;
     for (int irad = 0; irad < nrad; ++irad) {
-      for (int ieta = 0; ieta < neta; ++ieta) {
-        auto eta = lutHeader.etamap.eval(ieta);
-        lutEntry.eta = lutHeader.etamap.eval(ieta);
-        for (int ipt = 0; ipt < npt; ++ipt) {
-          lutEntry.pt = lutHeader.ptmap.eval(ipt);
-          lutEntry.valid = true;
-          if (fabs(eta) <= etaMaxBarrel) { // full lever arm ends at etaMaxBarrel
-            // printf(" --- fatSolve: pt = %f, eta = %f, mass = %f, field=%f \n", lutEntry.pt, lutEntry.eta, lutHeader.mass, lutHeader.field);
-            if (!fatSolve(lutEntry, lutEntry.pt, lutEntry.eta, lutHeader.mass, itof, otof, q)) {
-              // printf(" --- fatSolve: error \n");
-              lutEntry.valid = false;
-              lutEntry.eff = 0.;
-              lutEntry.eff2 = 0.;
-              for (int i = 0; i < 15; ++i)
-                lutEntry.covm[i] = 0.;
-            }
-          } else {
-            // printf(" --- fwdSolve: pt = %f, eta = %f, mass = %f, field=%f \n", lutEntry.pt, lutEntry.eta, lutHeader.mass, lutHeader.field);
-            lutEntry.eff = 1.;
-            lutEntry.eff2 = 1.;
-            bool retval = true;
-            if (useFlatDipole) { // Using the parametrization at the border of the barrel
-              retval = fatSolve(lutEntry, lutEntry.pt, etaMaxBarrel, lutHeader.mass, itof, otof, q);
-            } else if (usePara) {
-              retval = fwdPara(lutEntry, lutEntry.pt, lutEntry.eta, lutHeader.mass, field);
-            } else {
-              retval = fwdSolve(lutEntry.covm, lutEntry.pt, lutEntry.eta, lutHeader.mass);
-            }
-            if (useDipole) { // Using the parametrization at the border of the barrel only for efficiency and momentum resolution
-              lutEntry_t lutEntryBarrel;
-              retval = fatSolve(lutEntryBarrel, lutEntry.pt, etaMaxBarrel, lutHeader.mass, itof, otof, q);
-              lutEntry.valid = lutEntryBarrel.valid;
-              lutEntry.covm[14] = lutEntryBarrel.covm[14];
-              lutEntry.eff = lutEntryBarrel.eff;
-              lutEntry.eff2 = lutEntryBarrel.eff2;
-            }
-            if (!retval) {
-              // printf(" --- fwdSolve: error \n");
-              lutEntry.valid = false;
-              for (int i = 0; i < 15; ++i)
-                lutEntry.covm[i] = 0.;
-            }
-          }
-          diagonalise(lutEntry);
-          lutFile.write(reinterpret_cast<char*>(&lutEntry), sizeof(lutEntry_t));
-        }
-      }
+      // tracks are solved at the lower edge of the bin, the first bin is for primaries
+      auto rad = lutHeader.radmap.min + irad * (lutHeader.radmap.max - lutHeader.radmap.min) / nrad;
+      lutFat->SetProductionRadius(rad);
+      if (nrad > 1) std::cout << " --- setting FAT production radius: " << rad << std::endl;
+      std::vector<lutEntry_t> lutSlice(neta * npt, lutEntry);
+      lutSolveSlice(lutSlice.data(), lutHeader, lutShard.eta[0], lutShard.eta[1], q, itof, otof);
+      for (int ibin = lutShard.eta[0] * npt; ibin < lutShard.eta[1] * npt; ++ibin)
+        lutFile.write(reinterpret_cast<char*>(&lutSlice[ibin]), sizeof(lutEntry_t));
     }
   }
+  lutFat->SetProductionRadius(0.);
+  AliExternalTrackParam::SetUseLogTermMS(logTermMS);
 
   lutFile.close();
+
+  // store in the cache, through a temporary file as other writers may share it
+  if (!cachedFile.IsNull()) {
+    TString tmpFile = cachedFile + Form(".%d.tmp", gSystem->GetPid());
+    gSystem->mkdir(lutCacheDir, kTRUE);
+    if (gSystem->CopyFile(filename, tmpFile, kTRUE) != 0 || gSystem->Rename(tmpFile, cachedFile) != 0)
+      Printf("Did not manage to store %s in the LUT cache", filename);
+  }
+}
+
+TString
+lutCacheKey(const lutHeader_t &lutHeader, int itof, int otof)
+{
+  // hash of everything the LUT depends on: geometry, writer configuration and binning
+  auto mapKey = [](const map_t &map) { return Form("%d/%.9g/%.9g/%d", map.nbins, map.min, map.max, map.log); };
+  TString key = Form("writer=%d;version=%d;pdg=%d;mass=%.9g;field=%.9g;tof=%d/%d\n",
+                     LUTWRITE_VERSION, lutHeader.version, lutHeader.pdg, lutHeader.mass, lutHeader.field, itof, otof);
+  key += TString("nch=") + mapKey(lutHeader.nchmap);
+  key += TString(";rad=") + mapKey(lutHeader.radmap);
+  key += TString(";eta=") + mapKey(lutHeader.etamap);
+  key += TString(";pt=") + mapKey(lutHeader.ptmap) + "\n";
+  key += Form("etaMaxBarrel=%.9g;usePara=%d;useDipole=%d;useFlatDipole=%d;useEigen=%d;useEtaSymmetry=%d\n",
+              etaMaxBarrel, usePara, useDipole, useFlatDipole, useEigen, useEtaSymmetry);
+  for (auto &d : fwdDisks)
+    key += Form("fwd=%.9g/%.9g/%.9g/%.9g/%.9g/%.9g/%.9g/%.9g;", d.z, d.x2x0, d.xrho, d.resRPhi, d.resR, d.rmin, d.rmax, d.eff);
+  key += Form("fwdMinHits=%d\n", fwdMinHits);
+  key += lutFat->GetLayoutKey();
+  TMD5 md5;
+  md5.Update((const UChar_t *)key.Data(), key.Length());
+  md5.Final();
+  return md5.AsString();
+}
+
+void factorise(lutEntry_t& lutEntry)
+{
+  lutEntry.cholesky();
+  if (useEigen)
+    diagonalise(lutEntry);
 }
 
 void diagonalise(lutEntry_t& lutEntry)
@@ -4,7 +4,7 @@
 #include "lutWrite.cc"
 
 void
-fatInit_default(float field = 0.5, float rmin = 100.)
+fatInit_default(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
   fat.SetBField(field);
   fat.SetdNdEtaCent(400.);
@@ -41,6 +41,13 @@ fatInit_default(float field = 0.5, float rmin = 100.)
   fat.PrintLayout();
 }
 
+void
+fatInit_default(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_default(fat, field, rmin);
+}
+
 void
 lutWrite_default(const char *filename = "lutCovm.dat", int pdg = 211, float field = 0.5, float rmin = 100.)
 {
@@ -6,7 +6,7 @@
 float scale = 1.;
 
 void
-fatInit_geometry_v1(float field = 0.5, float rmin = 100.)
+fatInit_geometry_v1(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
   fat.SetBField(field);
   // new ideal Pixel properties?
@@ -48,6 +48,13 @@ fatInit_geometry_v1(float field = 0.5, float rmin = 100.)
   fat.PrintLayout();
 }
 
+void
+fatInit_geometry_v1(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_geometry_v1(fat, field, rmin);
+}
+
 void
 lutWrite_geometry_v1(const char *filename = "lutCovm.dat", int pdg = 211, float field = 0.5, float rmin = 100.)
 {
@@ -6,7 +6,7 @@
 float scale = 1.;
 
 void
-fatInit_geometry_v2(float field = 0.5, float rmin = 100.)
+fatInit_geometry_v2(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
   fat.SetBField(field);
   // new ideal Pixel properties?
@@ -53,6 +53,13 @@ fatInit_geometry_v2(float field = 0.5, float rmin = 100.)
   fat.PrintLayout();
 }
 
+void
+fatInit_geometry_v2(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_geometry_v2(fat, field, rmin);
+}
+
 void
 lutWrite_geometry_v2(const char *filename = "lutCovm.dat", int pdg = 211, float field = 0.5, float rmin = 100.)
 {
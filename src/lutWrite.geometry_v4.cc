@@ -3,7 +3,7 @@
 float scale = 1.;
 
 void
-fatInit_geometry_v4(float field = 0.5, float rmin = 100.)
+fatInit_geometry_v4(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
   fat.SetBField(field);
   // new ideal Pixel properties?
@@ -17,7 +17,6 @@ fatInit_geometry_v4(float field = 0.5, float rmin = 100.)
   Double_t resRPhiOB     = 0.00050;
   Double_t resZOB        = 0.00050;
   Double_t eff           = 0.98;
-  fat.SetBField(0.5); // Tesla
   fat.SetIntegrationTime(100.e-6); // 100 ns (as in LoI)
   fat.SetMaxRadiusOfSlowDetectors(0.00001); // no slow detectors
   fat.SetAvgRapidity(0.0);
@@ -54,6 +53,13 @@ fatInit_geometry_v4(float field = 0.5, float rmin = 100.)
   // fat.MakeStandardPlots(0,2,2,"LutQA");
 }
 
+void
+fatInit_geometry_v4(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_geometry_v4(fat, field, rmin);
+}
+
 void
 lutWrite_geometry_v4(const char *filename = "lutCovm.dat", int pdg = 211, float field = 0.5, float rmin = 100.)
 {
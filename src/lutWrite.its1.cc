@@ -5,7 +5,7 @@
 
 #include "lutWrite.cc"
 
-void fatInit_its1(float field = 0.5, float rmin = 100.)
+void fatInit_its1(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
 
   fat.SetBField(field);
@@ -20,6 +20,12 @@ void fatInit_its1(float field = 0.5, float rmin = 100.)
   fat.PrintLayout();
 }
 
+void fatInit_its1(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_its1(fat, field, rmin);
+}
+
 void lutWrite_its1(const char* filename = "lutCovm.dat", int pdg = 211,
                    float field = 0.2, float rmin = 20.)
 {
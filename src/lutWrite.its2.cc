@@ -5,7 +5,7 @@
 
 #include "lutWrite.cc"
 
-void fatInit_its2(float field = 0.5, float rmin = 100.)
+void fatInit_its2(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
   fat.SetBField(field);
   fat.SetdNdEtaCent(400.);
@@ -49,6 +49,12 @@ void fatInit_its2(float field = 0.5, float rmin = 100.)
   fat.PrintLayout();
 }
 
+void fatInit_its2(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_its2(fat, field, rmin);
+}
+
 void lutWrite_its2(const char* filename = "lutCovm.dat", int pdg = 211,
                    float field = 0.2, float rmin = 20.)
 {
@@ -10,7 +10,7 @@ const bool add_foam = true;
 // Puts foam spacers mid-way betwen layers
 const bool foam_middle = false;
 
-void fatInit_its3(float field = 0.5, float rmin = 100.)
+void fatInit_its3(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
   fat.SetBField(field);
   fat.SetdNdEtaCent(400.);
@@ -73,6 +73,12 @@ void fatInit_its3(float field = 0.5, float rmin = 100.)
   fat.PrintLayout();
 }
 
+void fatInit_its3(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_its3(fat, field, rmin);
+}
+
 void lutWrite_its3(const char* filename = "lutCovm.dat", int pdg = 211,
                    float field = 0.2, float rmin = 20.)
 {
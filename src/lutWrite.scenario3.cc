@@ -4,7 +4,7 @@
 #include "lutWrite.cc"
 
 void
-fatInit_scenario3(float field = 0.5, float rmin = 100.)
+fatInit_scenario3(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
   fat.SetBField(field);
   fat.SetdNdEtaCent(400.);
@@ -49,6 +49,13 @@ fatInit_scenario3(float field = 0.5, float rmin = 100.)
   fat.PrintLayout();
 }
 
+void
+fatInit_scenario3(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_scenario3(fat, field, rmin);
+}
+
 void
 lutWrite_scenario3(const char *filename = "lutCovm.dat", int pdg = 211, float field = 0.2, float rmin = 20.)
 {
@@ -4,7 +4,7 @@
 #include "lutWrite.cc"
 
 void
-fatInit_tof2(float field = 0.5, float rmin = 100.)
+fatInit_tof2(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
   fat.SetBField(field);
   fat.SetdNdEtaCent(400.);
@@ -41,6 +41,13 @@ fatInit_tof2(float field = 0.5, float rmin = 100.)
   fat.PrintLayout();
 }
 
+void
+fatInit_tof2(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_tof2(fat, field, rmin);
+}
+
 void
 lutWrite_tof2(const char *filename = "lutCovm.dat", int pdg = 211, float field = 0.2, float rmin = 20.)
 {
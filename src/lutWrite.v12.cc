@@ -6,7 +6,7 @@
 float scale = 1.;
 
 void
-fatInit_v12(float field = 0.5, float rmin = 100.)
+fatInit_v12(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
   fat.SetBField(field);
   // new ideal Pixel properties?
@@ -47,6 +47,14 @@ fatInit_v12(float field = 0.5, float rmin = 100.)
   fat.PrintLayout();
 }
 
+void
+fatInit_v12(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_v12(fat, field, rmin);
+  usePara = true; // use parametrisation for forward resolution
+}
+
 void
 lutWrite_v12(const char *filename = "lutCovm.dat", int pdg = 211, float field = 0.5, float rmin = 100.)
 {
@@ -54,7 +62,7 @@ lutWrite_v12(const char *filename = "lutCovm.dat", int pdg = 211, float field =
   // init FAT
   fatInit_v12(field, rmin);
   // write
-  lutWrite(filename, pdg, field, 0, 0, 0, 1); // last flag: use parametrisation for forward resolution
+  lutWrite(filename, pdg, field);
   
 }
   
@@ -6,7 +6,7 @@
 float scale = 1.;
 
 void
-fatInit_werner(float field = 0.5, float rmin = 100.)
+fatInit_werner(DetectorK &fat, float field = 0.5, float rmin = 100.)
 {
   fat.SetBField(field);
   // new ideal Pixel properties?
@@ -47,6 +47,13 @@ fatInit_werner(float field = 0.5, float rmin = 100.)
   fat.PrintLayout();
 }
 
+void
+fatInit_werner(float field = 0.5, float rmin = 100.)
+{
+  // the global geometry used by lutWrite
+  fatInit_werner(fat, field, rmin);
+}
+
 void
 lutWrite_werner(const char *filename = "lutCovm.dat", int pdg = 211, float field = 0.5, float rmin = 100.)
 {
@@ -272,7 +272,7 @@ void lutWrite_aod(const char* filename = "/tmp/lutCovm.pi.aod.dat",
               // }
             }
           }
-          diagonalise(lutEntry);
+          factorise(lutEntry);
           if (lutEntry.valid) {
             Printf("Writing valid entry at pT %f and eta %f:", lutEntry.pt, lutEntry.eta);
             lutEntry.print();